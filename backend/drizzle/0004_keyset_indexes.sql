@@ -0,0 +1,2 @@
+CREATE INDEX "temperature_readings_device_taken_at_idx" ON "temperature_readings" USING btree ("device_id","taken_at","id");--> statement-breakpoint
+CREATE INDEX "temperature_aggregates_device_bucket_idx" ON "temperature_aggregates" USING btree ("device_id","granularity","bucket_start","id");
\ No newline at end of file
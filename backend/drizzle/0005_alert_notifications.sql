@@ -0,0 +1,22 @@
+CREATE TABLE "alert_notifications" (
+	"id" serial PRIMARY KEY NOT NULL,
+	"alert_id" integer NOT NULL,
+	"device_id" varchar(128),
+	"recipient" text NOT NULL,
+	"type" varchar(20) NOT NULL,
+	"value" real NOT NULL,
+	"min_threshold" real,
+	"max_threshold" real,
+	"triggered_at" timestamp with time zone NOT NULL,
+	"dedupe_key" varchar(255) NOT NULL,
+	"status" varchar(16) DEFAULT 'pending' NOT NULL,
+	"attempts" integer DEFAULT 0 NOT NULL,
+	"next_attempt_at" timestamp with time zone DEFAULT now() NOT NULL,
+	"last_error" text,
+	"sent_at" timestamp with time zone,
+	"created_at" timestamp with time zone DEFAULT now() NOT NULL
+);
+--> statement-breakpoint
+ALTER TABLE "alert_notifications" ADD CONSTRAINT "alert_notifications_alert_id_alerts_id_fk" FOREIGN KEY ("alert_id") REFERENCES "public"."alerts"("id") ON DELETE cascade ON UPDATE no action;--> statement-breakpoint
+CREATE UNIQUE INDEX "alert_notifications_dedupe_idx" ON "alert_notifications" USING btree ("dedupe_key");--> statement-breakpoint
+CREATE INDEX "alert_notifications_due_idx" ON "alert_notifications" USING btree ("status","next_attempt_at");
\ No newline at end of file
@@ -0,0 +1,15 @@
+CREATE TABLE "location_aggregates" (
+	"id" serial PRIMARY KEY NOT NULL,
+	"location_id" integer NOT NULL,
+	"granularity" varchar(8) NOT NULL,
+	"bucket_start" timestamp with time zone NOT NULL,
+	"avg_c" real NOT NULL,
+	"min_c" real NOT NULL,
+	"max_c" real NOT NULL,
+	"avg_humidity" real,
+	"reading_count" integer NOT NULL,
+	"device_count" integer NOT NULL
+);
+--> statement-breakpoint
+ALTER TABLE "location_aggregates" ADD CONSTRAINT "location_aggregates_location_id_locations_id_fk" FOREIGN KEY ("location_id") REFERENCES "public"."locations"("id") ON DELETE cascade ON UPDATE no action;--> statement-breakpoint
+CREATE UNIQUE INDEX "location_aggregates_bucket_idx" ON "location_aggregates" USING btree ("location_id","granularity","bucket_start");
\ No newline at end of file
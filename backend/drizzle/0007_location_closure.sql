@@ -0,0 +1,21 @@
+CREATE TABLE "location_closure" (
+	"ancestor_id" integer NOT NULL,
+	"descendant_id" integer NOT NULL,
+	"depth" integer NOT NULL,
+	CONSTRAINT "location_closure_ancestor_id_descendant_id_pk" PRIMARY KEY("ancestor_id","descendant_id")
+);
+--> statement-breakpoint
+ALTER TABLE "location_closure" ADD CONSTRAINT "location_closure_ancestor_id_locations_id_fk" FOREIGN KEY ("ancestor_id") REFERENCES "public"."locations"("id") ON DELETE cascade ON UPDATE no action;--> statement-breakpoint
+ALTER TABLE "location_closure" ADD CONSTRAINT "location_closure_descendant_id_locations_id_fk" FOREIGN KEY ("descendant_id") REFERENCES "public"."locations"("id") ON DELETE cascade ON UPDATE no action;--> statement-breakpoint
+CREATE INDEX "location_closure_descendant_idx" ON "location_closure" USING btree ("descendant_id");--> statement-breakpoint
+-- Backfill from the existing parent links
+INSERT INTO "location_closure" ("ancestor_id", "descendant_id", "depth")
+WITH RECURSIVE "tree" AS (
+	SELECT "id" AS "ancestor_id", "id" AS "descendant_id", 0 AS "depth"
+	FROM "locations"
+	UNION ALL
+	SELECT "tree"."ancestor_id", "locations"."id", "tree"."depth" + 1
+	FROM "tree"
+	JOIN "locations" ON "locations"."parent_id" = "tree"."descendant_id"
+)
+SELECT "ancestor_id", "descendant_id", "depth" FROM "tree";
\ No newline at end of file
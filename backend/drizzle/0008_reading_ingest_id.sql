@@ -0,0 +1,2 @@
+ALTER TABLE "temperature_readings" ADD COLUMN "ingest_id" uuid;--> statement-breakpoint
+CREATE UNIQUE INDEX "temperature_readings_ingest_id_idx" ON "temperature_readings" USING btree ("ingest_id");
\ No newline at end of file
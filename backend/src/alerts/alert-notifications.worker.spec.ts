@@ -0,0 +1,201 @@
+import { mkdtemp, readFile, rm } from 'fs/promises';
+import { tmpdir } from 'os';
+import { join } from 'path';
+import { DbClient } from '../db/client';
+import { alertNotifications } from '../db/schema';
+import { MetricsService } from '../metrics/metrics.service';
+import { AlertNotificationsWorker } from './alert-notifications.worker';
+import { FileSinkTransport, MailMessage } from './mail-transport';
+
+// Exposes the ids an update targets; the claim passes a subquery instead
+jest.mock('drizzle-orm', () => ({
+  ...jest.requireActual<object>('drizzle-orm'),
+  inArray: (_column: unknown, ids: unknown) => ({ ids }),
+}));
+
+type Notification = typeof alertNotifications.$inferSelect;
+
+const HOUR = 60 * 60 * 1000;
+
+function notification(id: number, overrides: Partial<Notification> = {}) {
+  return {
+    id,
+    alertId: 1,
+    deviceId: 'device-1',
+    recipient: 'ops@example.com',
+    type: 'temperature',
+    value: 31,
+    minThreshold: null,
+    maxThreshold: 30,
+    triggeredAt: new Date('2025-01-06T12:00:00Z'),
+    dedupeKey: `1:ops@example.com:${id}`,
+    status: 'pending',
+    attempts: 0,
+    nextAttemptAt: new Date(0),
+    lastError: null,
+    sentAt: null,
+    createdAt: new Date(0),
+    ...overrides,
+  } as Notification;
+}
+
+/**
+ * Just enough of drizzle's update builder for the worker, over rows in
+ * memory. `now()` in the claim query is the real clock plus `skew`, which
+ * tests move forward to make retries due.
+ */
+function fakeDb(rows: Notification[]) {
+  const state = { skew: 0 };
+  const db = {
+    update: () => ({
+      set: (values: Partial<Notification>) => ({
+        where: ({ ids }: { ids: number[] | unknown }) => {
+          if (Array.isArray(ids)) {
+            rows
+              .filter((row) => ids.includes(row.id))
+              .forEach((row) => Object.assign(row, values));
+            return Promise.resolve();
+          }
+          const now = Date.now() + state.skew;
+          const claimed = rows
+            .filter(
+              (row) =>
+                row.status === 'pending' && row.nextAttemptAt.getTime() <= now,
+            )
+            .sort((a, b) => a.id - b.id);
+          claimed.forEach((row) => {
+            row.attempts++;
+            row.nextAttemptAt = values.nextAttemptAt!;
+          });
+          return Object.assign(Promise.resolve(), {
+            returning: () =>
+              Promise.resolve(claimed.map((row) => ({ ...row }))),
+          });
+        },
+      }),
+    }),
+  };
+  return { dbClient: { db } as unknown as DbClient, state };
+}
+
+describe('AlertNotificationsWorker', () => {
+  let dir: string;
+  let sinkPath: string;
+  let failing: boolean;
+  const metrics = {
+    alertNotifications: { inc: jest.fn() },
+  } as unknown as MetricsService;
+
+  const start = (rows: Notification[]) => {
+    const sink = new FileSinkTransport(sinkPath);
+    const transport = {
+      send: (message: MailMessage) =>
+        failing
+          ? Promise.reject(new Error('provider unavailable'))
+          : sink.send(message),
+    };
+    const { dbClient, state } = fakeDb(rows);
+    return {
+      worker: new AlertNotificationsWorker(dbClient, transport, metrics),
+      state,
+    };
+  };
+
+  const sent = async (): Promise<MailMessage[]> => {
+    const lines = await readFile(sinkPath, 'utf8').catch(() => '');
+    return lines
+      .split('\n')
+      .filter(Boolean)
+      .map((line) => JSON.parse(line) as MailMessage);
+  };
+
+  beforeEach(async () => {
+    dir = await mkdtemp(join(tmpdir(), 'alert-mail-'));
+    sinkPath = join(dir, 'mail.jsonl');
+    failing = false;
+  });
+
+  afterEach(async () => {
+    await rm(dir, { recursive: true, force: true });
+  });
+
+  it('sends one digest per recipient and marks the rows sent', async () => {
+    const rows = [
+      notification(1),
+      notification(2, { deviceId: 'device-2' }),
+      notification(3, { recipient: 'oncall@example.com' }),
+      notification(4, { nextAttemptAt: new Date(Date.now() + HOUR) }),
+      notification(5, { status: 'sent' }),
+    ];
+    const { worker } = start(rows);
+
+    await worker.deliverPending();
+
+    const messages = await sent();
+    expect(messages.map(({ to, subject }) => ({ to, subject }))).toEqual([
+      { to: 'ops@example.com', subject: '2 Alerts Triggered' },
+      {
+        to: 'oncall@example.com',
+        subject: 'Alert Triggered: temperature on Device device-1',
+      },
+    ]);
+    expect(rows.map((row) => row.status)).toEqual([
+      'sent',
+      'sent',
+      'sent',
+      'pending',
+      'sent',
+    ]);
+    expect(rows[0].sentAt).toBeInstanceOf(Date);
+    expect(rows[3].attempts).toBe(0);
+  });
+
+  it('backs off after a failed send and delivers on the retry', async () => {
+    const rows = [notification(1)];
+    const { worker, state } = start(rows);
+
+    failing = true;
+    const before = Date.now();
+    await worker.deliverPending();
+
+    expect(rows[0]).toMatchObject({
+      status: 'pending',
+      attempts: 1,
+      lastError: 'provider unavailable',
+    });
+    const delay = rows[0].nextAttemptAt.getTime() - before;
+    expect(delay).toBeGreaterThanOrEqual(30_000);
+    expect(delay).toBeLessThan(31_000);
+
+    // Not due yet
+    failing = false;
+    await worker.deliverPending();
+    expect(await sent()).toHaveLength(0);
+
+    state.skew = HOUR;
+    await worker.deliverPending();
+    expect(await sent()).toHaveLength(1);
+    expect(rows[0]).toMatchObject({
+      status: 'sent',
+      attempts: 2,
+      lastError: null,
+    });
+  });
+
+  it('gives up after five attempts', async () => {
+    const rows = [notification(1)];
+    const { worker, state } = start(rows);
+    failing = true;
+
+    for (let attempt = 1; attempt <= 5; attempt++) {
+      state.skew = attempt * HOUR;
+      await worker.deliverPending();
+    }
+
+    expect(rows[0]).toMatchObject({ status: 'failed', attempts: 5 });
+    state.skew = 10 * HOUR;
+    failing = false;
+    await worker.deliverPending();
+    expect(await sent()).toHaveLength(0);
+  });
+});
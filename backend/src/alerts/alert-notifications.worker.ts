@@ -0,0 +1,161 @@
+import { Inject, Injectable, Logger } from '@nestjs/common';
+import { Interval } from '@nestjs/schedule';
+import { inArray, sql } from 'drizzle-orm';
+import { DbClient } from '../db/client';
+import { alertNotifications } from '../db/schema';
+import { MetricsService } from '../metrics/metrics.service';
+import { MAIL_TRANSPORT, MailTransport } from './mail-transport';
+
+type Notification = typeof alertNotifications.$inferSelect;
+
+const BATCH_SIZE = 200;
+const MAX_ATTEMPTS = 5;
+// How long a claimed batch is hidden from other workers while sending
+const CLAIM_LEASE_MS = 5 * 60 * 1000;
+const RETRY_BASE_MS = 30 * 1000;
+
+/**
+ * Delivers queued alert notifications outside the ingest path. Due rows are
+ * claimed with SKIP LOCKED, grouped into one digest email per recipient and
+ * retried with exponential backoff when the mail provider fails.
+ */
+@Injectable()
+export class AlertNotificationsWorker {
+  private readonly logger = new Logger('AlertNotificationsWorker');
+  private running = false;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    @Inject(MAIL_TRANSPORT) private readonly mailTransport: MailTransport,
+    private readonly metricsService: MetricsService,
+  ) {}
+
+  @Interval(10_000)
+  async deliverPending() {
+    if (this.running) return;
+    this.running = true;
+
+    try {
+      let claimed: Notification[];
+      do {
+        claimed = await this.claimBatch();
+        await this.deliver(claimed);
+      } while (claimed.length === BATCH_SIZE);
+    } catch (error) {
+      this.logger.error(`Alert delivery run failed: ${error}`);
+    } finally {
+      this.running = false;
+    }
+  }
+
+  private async claimBatch(): Promise<Notification[]> {
+    return this.dbClient.db
+      .update(alertNotifications)
+      .set({
+        attempts: sql`${alertNotifications.attempts} + 1`,
+        nextAttemptAt: new Date(Date.now() + CLAIM_LEASE_MS),
+      })
+      .where(
+        inArray(
+          alertNotifications.id,
+          sql`(
+            SELECT ${alertNotifications.id}
+            FROM ${alertNotifications}
+            WHERE ${alertNotifications.status} = 'pending'
+              AND ${alertNotifications.nextAttemptAt} <= now()
+            ORDER BY ${alertNotifications.id}
+            LIMIT ${BATCH_SIZE}
+            FOR UPDATE SKIP LOCKED
+          )`,
+        ),
+      )
+      .returning();
+  }
+
+  private async deliver(claimed: Notification[]) {
+    const byRecipient = new Map<string, Notification[]>();
+    for (const notification of claimed) {
+      const group = byRecipient.get(notification.recipient) ?? [];
+      group.push(notification);
+      byRecipient.set(notification.recipient, group);
+    }
+
+    for (const [recipient, notifications] of byRecipient) {
+      const ids = notifications.map((n) => n.id);
+      try {
+        await this.mailTransport.send(digest(recipient, notifications));
+        await this.dbClient.db
+          .update(alertNotifications)
+          .set({ status: 'sent', sentAt: new Date(), lastError: null })
+          .where(inArray(alertNotifications.id, ids));
+        this.metricsService.alertNotifications.inc(
+          { result: 'sent' },
+          notifications.length,
+        );
+        this.logger.log(
+          `Sent ${notifications.length} alert(s) to ${recipient}`,
+        );
+      } catch (error) {
+        const message = error instanceof Error ? error.message : String(error);
+        this.logger.warn(`Failed to send alerts to ${recipient}: ${message}`);
+        this.metricsService.alertNotifications.inc(
+          { result: 'failed' },
+          notifications.length,
+        );
+        await this.scheduleRetry(notifications, message);
+      }
+    }
+  }
+
+  private async scheduleRetry(notifications: Notification[], error: string) {
+    // All rows of a digest were claimed together, so they share attempts
+    const attempts = Math.max(...notifications.map((n) => n.attempts));
+    const ids = notifications.map((n) => n.id);
+
+    await this.dbClient.db
+      .update(alertNotifications)
+      .set(
+        attempts >= MAX_ATTEMPTS
+          ? { status: 'failed', lastError: error }
+          : {
+              lastError: error,
+              nextAttemptAt: new Date(
+                Date.now() + RETRY_BASE_MS * 2 ** (attempts - 1),
+              ),
+            },
+      )
+      .where(inArray(alertNotifications.id, ids));
+  }
+}
+
+function digest(recipient: string, notifications: Notification[]) {
+  const rows = notifications
+    .map(
+      (n) => `
+        <tr>
+          <td>${n.deviceId}</td>
+          <td>${n.type}</td>
+          <td>${n.value}</td>
+          <td>Min: ${n.minThreshold ?? 'N/A'}, Max: ${n.maxThreshold ?? 'N/A'}</td>
+          <td>${n.triggeredAt.toLocaleString()}</td>
+        </tr>`,
+    )
+    .join('');
+
+  const first = notifications[0];
+  return {
+    to: recipient,
+    subject:
+      notifications.length === 1
+        ? `Alert Triggered: ${first.type} on Device ${first.deviceId}`
+        : `${notifications.length} Alerts Triggered`,
+    html: `
+      <h1>Alert${notifications.length === 1 ? '' : 's'} Triggered</h1>
+      <table>
+        <tr>
+          <th>Device</th><th>Type</th><th>Value</th><th>Thresholds</th><th>Time</th>
+        </tr>${rows}
+      </table>
+    `,
+  };
+}
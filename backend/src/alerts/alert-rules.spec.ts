@@ -0,0 +1,73 @@
+import { alerts } from '../db/schema';
+import { compileAlert, isActive, isViolated, weekMinute } from './alert-rules';
+
+type Alert = typeof alerts.$inferSelect;
+
+function alert(overrides: Partial<Alert>): Alert {
+  return {
+    id: 1,
+    deviceId: 'device-1',
+    type: 'temperature',
+    minThreshold: null,
+    maxThreshold: 30,
+    startTime: null,
+    endTime: null,
+    startDate: null,
+    endDate: null,
+    daysOfWeek: null,
+    emails: ['ops@example.com'],
+    enabled: true,
+    lastTriggeredAt: null,
+    createdAt: new Date(),
+    updatedAt: new Date(),
+    ...overrides,
+  };
+}
+
+// 2025-01-06 is a Monday
+const at = (day: number, time: string) =>
+  new Date(`2025-01-${String(6 + day - 1).padStart(2, '0')}T${time}:00`);
+
+const active = (rule: ReturnType<typeof compileAlert>, date: Date) =>
+  isActive(rule, date.getTime(), weekMinute(date));
+
+describe('alert rules', () => {
+  it('is always active without a schedule', () => {
+    const rule = compileAlert(alert({}));
+    expect(rule.schedule).toBeNull();
+    expect(active(rule, at(1, '03:15'))).toBe(true);
+  });
+
+  it('matches a daytime window on selected days', () => {
+    const rule = compileAlert(
+      alert({ startTime: '09:00', endTime: '17:00', daysOfWeek: [1, 2] }),
+    );
+    expect(active(rule, at(1, '09:00'))).toBe(true);
+    expect(active(rule, at(2, '17:00'))).toBe(true);
+    expect(active(rule, at(1, '17:01'))).toBe(false);
+    expect(active(rule, at(3, '12:00'))).toBe(false);
+  });
+
+  it('wraps overnight windows around midnight', () => {
+    const rule = compileAlert(alert({ startTime: '22:00', endTime: '06:00' }));
+    expect(active(rule, at(1, '23:30'))).toBe(true);
+    expect(active(rule, at(2, '05:59'))).toBe(true);
+    expect(active(rule, at(2, '12:00'))).toBe(false);
+  });
+
+  it('respects the date range', () => {
+    const rule = compileAlert(
+      alert({ startDate: at(2, '00:00'), endDate: at(3, '00:00') }),
+    );
+    expect(active(rule, at(1, '12:00'))).toBe(false);
+    expect(active(rule, at(2, '12:00'))).toBe(true);
+    expect(active(rule, at(4, '12:00'))).toBe(false);
+  });
+
+  it('checks thresholds', () => {
+    const rule = compileAlert(alert({ minThreshold: 10, maxThreshold: 30 }));
+    expect(isViolated(rule, 9.5)).toBe(true);
+    expect(isViolated(rule, 20)).toBe(false);
+    expect(isViolated(rule, 30.5)).toBe(true);
+  });
+});
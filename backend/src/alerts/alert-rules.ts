@@ -0,0 +1,97 @@
+import { alerts } from '../db/schema';
+
+type Alert = typeof alerts.$inferSelect;
+
+const MINUTES_PER_DAY = 24 * 60;
+const MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+
+/**
+ * An alert row pre-processed for evaluation on every reading: the
+ * day-of-week and time-of-day schedule becomes a bitmap over the minutes of
+ * the week and the date range becomes epoch bounds, so matching a reading
+ * is a bit test plus a few number comparisons.
+ */
+export interface CompiledAlert {
+  alert: Alert;
+  // One bit per minute of the week (Sunday 00:00 = 0), null = always active
+  schedule: Uint8Array | null;
+  startsAt: number;
+  endsAt: number;
+  min: number | null;
+  max: number | null;
+  lastTriggeredAt: number | null;
+}
+
+function parseMinutes(time: string): number {
+  const [hours, minutes] = time.split(':').map(Number);
+  return hours * 60 + minutes;
+}
+
+function compileSchedule(alert: Alert): Uint8Array | null {
+  const days =
+    alert.daysOfWeek && alert.daysOfWeek.length > 0 ? alert.daysOfWeek : null;
+  const window =
+    alert.startTime && alert.endTime
+      ? {
+          start: parseMinutes(alert.startTime),
+          end: parseMinutes(alert.endTime),
+        }
+      : null;
+
+  if (!days && !window) return null;
+
+  const bitmap = new Uint8Array(MINUTES_PER_WEEK / 8);
+  for (let day = 0; day < 7; day++) {
+    if (days && !days.includes(day)) continue;
+
+    for (let minute = 0; minute < MINUTES_PER_DAY; minute++) {
+      // Overnight windows (e.g. 22:00-06:00) wrap within the same day,
+      // matching the day-of-week of the reading rather than the window start
+      const inWindow =
+        !window ||
+        (window.start <= window.end
+          ? minute >= window.start && minute <= window.end
+          : minute >= window.start || minute <= window.end);
+
+      if (inWindow) {
+        const bit = day * MINUTES_PER_DAY + minute;
+        bitmap[bit >> 3] |= 1 << (bit & 7);
+      }
+    }
+  }
+  return bitmap;
+}
+
+export function compileAlert(alert: Alert): CompiledAlert {
+  return {
+    alert,
+    schedule: compileSchedule(alert),
+    startsAt: alert.startDate ? alert.startDate.getTime() : -Infinity,
+    endsAt: alert.endDate ? alert.endDate.getTime() : Infinity,
+    min: alert.minThreshold,
+    max: alert.maxThreshold,
+    lastTriggeredAt: alert.lastTriggeredAt
+      ? alert.lastTriggeredAt.getTime()
+      : null,
+  };
+}
+
+// Minute of the week in server local time, as the HH:mm schedule is stored
+export function weekMinute(now: Date): number {
+  return (
+    now.getDay() * MINUTES_PER_DAY + now.getHours() * 60 + now.getMinutes()
+  );
+}
+
+export function isActive(rule: CompiledAlert, now: number, minute: number) {
+  if (now < rule.startsAt || now > rule.endsAt) return false;
+  if (!rule.schedule) return true;
+  return (rule.schedule[minute >> 3] & (1 << (minute & 7))) !== 0;
+}
+
+export function isViolated(rule: CompiledAlert, value: number) {
+  return (
+    (rule.min !== null && value < rule.min) ||
+    (rule.max !== null && value > rule.max)
+  );
+}
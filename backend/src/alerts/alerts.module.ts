@@ -1,13 +1,34 @@
 import { Module } from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
 import { AlertsController } from './alerts.controller';
 import { AlertsService } from './alerts.service';
+import { AlertNotificationsWorker } from './alert-notifications.worker';
+import {
+  FileSinkTransport,
+  MAIL_TRANSPORT,
+  ResendTransport,
+} from './mail-transport';
 import { DbModule } from '../db/db.module';
 import { SupabaseModule } from 'src/auth/supabase.module';
 
 @Module({
   imports: [DbModule, SupabaseModule],
   controllers: [AlertsController],
-  providers: [AlertsService],
+  providers: [
+    AlertsService,
+    AlertNotificationsWorker,
+    {
+      // MAIL_TRANSPORT=file writes emails to MAIL_SINK_PATH for local testing
+      provide: MAIL_TRANSPORT,
+      inject: [ConfigService],
+      useFactory: (configService: ConfigService) =>
+        configService.get<string>('MAIL_TRANSPORT') === 'file'
+          ? new FileSinkTransport(
+              configService.get<string>('MAIL_SINK_PATH') ?? 'mail-sink.jsonl',
+            )
+          : new ResendTransport(configService.get<string>('RESEND_API_KEY')),
+    },
+  ],
   exports: [AlertsService],
 })
 export class AlertsModule {}
@@ -1,22 +1,34 @@
 import { Injectable } from '@nestjs/common';
 import { DbClient } from '../db/client';
-import { alerts } from '../db/schema';
-import { and, eq } from 'drizzle-orm';
-import { Resend } from 'resend';
-import { ConfigService } from '@nestjs/config';
+import { MetricsService } from '../metrics/metrics.service';
+import { ClusterService } from '../cluster/cluster.service';
+import { alertNotifications, alerts } from '../db/schema';
+import { eq, inArray } from 'drizzle-orm';
 
 import { CreateAlertDto } from './dto/create-alert.dto';
 import { UpdateAlertDto } from './dto/update-alert.dto';
+import {
+  CompiledAlert,
+  compileAlert,
+  isActive,
+  isViolated,
+  weekMinute,
+} from './alert-rules';
 
 @Injectable()
 export class AlertsService {
-  private readonly resend: Resend;
+  private rules: Promise<Map<string, CompiledAlert[]>> | null = null;
+  private readonly invalidateRules: () => void;
 
   constructor(
     private readonly dbClient: DbClient,
-    private readonly configService: ConfigService,
+    private readonly metricsService: MetricsService,
+    clusterService: ClusterService,
   ) {
-    this.resend = new Resend(this.configService.get<string>('RESEND_API_KEY'));
+    // Rules are evaluated on whichever instance ingests the reading
+    this.invalidateRules = clusterService.invalidation('alerts:rules', () => {
+      this.rules = null;
+    });
   }
 
   async create(createAlertDto: CreateAlertDto) {
@@ -33,6 +45,7 @@ export class AlertsService {
           : undefined,
       })
       .returning();
+    this.invalidateRules();
     return alert;
   }
 
@@ -69,6 +82,7 @@ export class AlertsService {
       })
       .where(eq(alerts.id, id))
       .returning();
+    this.invalidateRules();
     return alert;
   }
 
@@ -78,119 +92,103 @@ export class AlertsService {
       .delete(alerts)
       .where(eq(alerts.id, id))
       .returning();
+    this.invalidateRules();
     return alert;
   }
 
   async checkAlerts(deviceId: string, temperature: number, humidity?: number) {
-    const db = this.dbClient.db;
-    const deviceAlerts = await db
-      .select()
-      .from(alerts)
-      .where(and(eq(alerts.deviceId, deviceId), eq(alerts.enabled, true)));
+    const rules = (await this.loadRules()).get(deviceId);
+    if (!rules) return;
 
     const now = new Date();
-    const currentDay = now.getDay(); // 0-6
-    const currentHour = now.getHours();
-    const currentMinute = now.getMinutes();
-    const currentTimeStr = `${currentHour.toString().padStart(2, '0')}:${currentMinute.toString().padStart(2, '0')}`;
-
-    for (const alert of deviceAlerts) {
-      // 1. Check Date Range
-      if (alert.startDate && now < alert.startDate) continue;
-      if (alert.endDate && now > alert.endDate) continue;
-
-      // 2. Check Days of the Week
+    const nowMs = now.getTime();
+    const minute = weekMinute(now);
+    const hour = Math.floor(nowMs / (60 * 60 * 1000));
+    const triggered: CompiledAlert[] = [];
+    const notifications: (typeof alertNotifications.$inferInsert)[] = [];
+    this.metricsService.alertEvaluations.inc({}, rules.length);
+
+    for (const rule of rules) {
+      if (!isActive(rule, nowMs, minute)) continue;
+
+      const value =
+        rule.alert.type === 'temperature'
+          ? temperature
+          : rule.alert.type === 'humidity'
+            ? humidity
+            : undefined;
+      if (value === undefined || !isViolated(rule, value)) continue;
+
+      // Throttle: at most one notification per hour per alert
       if (
-        alert.daysOfWeek &&
-        alert.daysOfWeek.length > 0 &&
-        !alert.daysOfWeek.includes(currentDay)
+        rule.lastTriggeredAt !== null &&
+        nowMs - rule.lastTriggeredAt < 60 * 60 * 1000
       ) {
         continue;
       }
-
-      // 3. Check Time Range
-      if (alert.startTime && alert.endTime) {
-        if (alert.startTime <= alert.endTime) {
-          // e.g. 09:00 to 17:00
-          if (
-            currentTimeStr < alert.startTime ||
-            currentTimeStr > alert.endTime
-          )
-            continue;
-        } else {
-          // e.g. 22:00 to 06:00 (overnight)
-          if (
-            currentTimeStr < alert.startTime &&
-            currentTimeStr > alert.endTime
-          )
-            continue;
-        }
+      rule.lastTriggeredAt = nowMs;
+      triggered.push(rule);
+
+      for (const recipient of rule.alert.emails) {
+        notifications.push({
+          alertId: rule.alert.id,
+          deviceId,
+          recipient,
+          type: rule.alert.type,
+          value,
+          minThreshold: rule.min,
+          maxThreshold: rule.max,
+          triggeredAt: now,
+          dedupeKey: `${rule.alert.id}:${recipient}:${hour}`,
+        });
       }
+    }
 
-      // 4. Check Thresholds
-      let triggered = false;
-      let value = 0;
-      if (alert.type === 'temperature') {
-        value = temperature;
-        if (
-          (alert.minThreshold !== null && temperature < alert.minThreshold) ||
-          (alert.maxThreshold !== null && temperature > alert.maxThreshold)
-        ) {
-          triggered = true;
-        }
-      } else if (alert.type === 'humidity' && humidity !== undefined) {
-        value = humidity;
-        if (
-          (alert.minThreshold !== null && humidity < alert.minThreshold) ||
-          (alert.maxThreshold !== null && humidity > alert.maxThreshold)
-        ) {
-          triggered = true;
-        }
-      }
+    if (triggered.length === 0) return;
+    this.metricsService.alertsTriggered.inc({}, triggered.length);
 
-      if (triggered) {
-        // 5. Check Throttling (e.g., 1 hour cooldown)
-        const lastTriggered = alert.lastTriggeredAt;
-        if (
-          lastTriggered &&
-          now.getTime() - lastTriggered.getTime() < 60 * 60 * 1000
-        ) {
-          continue;
-        }
-
-        // 6. Send Email
-        await this.sendAlertEmail(alert, value);
-
-        // 7. Update lastTriggeredAt
-        await db
-          .update(alerts)
-          .set({ lastTriggeredAt: now })
-          .where(eq(alerts.id, alert.id));
-      }
+    // Delivery happens in AlertNotificationsWorker; ingest only queues
+    const db = this.dbClient.db;
+    if (notifications.length > 0) {
+      await db
+        .insert(alertNotifications)
+        .values(notifications)
+        .onConflictDoNothing({ target: alertNotifications.dedupeKey });
     }
+    await db
+      .update(alerts)
+      .set({ lastTriggeredAt: now })
+      .where(inArray(alerts.id, triggered.map((rule) => rule.alert.id)));
   }
 
-  private async sendAlertEmail(
-    alert: typeof alerts.$inferSelect,
-    value: number,
-  ) {
-    try {
-      await this.resend.emails.send({
-        from: 'HeatSync Alerts <onboarding@resend.dev>', // Default Resend sender
-        to: alert.emails,
-        subject: `Alert Triggered: ${alert.type} on Device ${alert.deviceId}`,
-        html: `
-          <h1>Alert Triggered</h1>
-          <p><strong>Device:</strong> ${alert.deviceId}</p>
-          <p><strong>Type:</strong> ${alert.type}</p>
-          <p><strong>Current Value:</strong> ${value}</p>
-          <p><strong>Thresholds:</strong> Min: ${alert.minThreshold ?? 'N/A'}, Max: ${alert.maxThreshold ?? 'N/A'}</p>
-          <p><strong>Time:</strong> ${new Date().toLocaleString()}</p>
-        `,
+  /**
+   * Enabled alerts compiled and grouped by device. Loaded once and dropped
+   * on any create/update/remove, so evaluating a reading needs no query.
+   */
+  private loadRules(): Promise<Map<string, CompiledAlert[]>> {
+    if (!this.rules) {
+      const rules = this.queryRules();
+      rules.catch(() => {
+        if (this.rules === rules) this.rules = null;
       });
-      console.log(`Alert email sent to ${alert.emails.join(', ')}`);
-    } catch (error) {
-      console.error('Failed to send alert email:', error);
+      this.rules = rules;
+    }
+    return this.rules;
+  }
+
+  private async queryRules(): Promise<Map<string, CompiledAlert[]>> {
+    const enabled = await this.dbClient.db
+      .select()
+      .from(alerts)
+      .where(eq(alerts.enabled, true));
+
+    const index = new Map<string, CompiledAlert[]>();
+    for (const alert of enabled) {
+      if (!alert.deviceId) continue;
+      const deviceRules = index.get(alert.deviceId) ?? [];
+      deviceRules.push(compileAlert(alert));
+      index.set(alert.deviceId, deviceRules);
     }
+    return index;
   }
 }
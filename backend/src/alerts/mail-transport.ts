@@ -0,0 +1,44 @@
+import { appendFile } from 'fs/promises';
+import { Resend } from 'resend';
+
+export interface MailMessage {
+  to: string;
+  subject: string;
+  html: string;
+}
+
+export interface MailTransport {
+  send(message: MailMessage): Promise<void>;
+}
+
+export const MAIL_TRANSPORT = Symbol('MAIL_TRANSPORT');
+
+export class ResendTransport implements MailTransport {
+  private readonly resend: Resend;
+
+  constructor(apiKey: string | undefined) {
+    this.resend = new Resend(apiKey);
+  }
+
+  async send(message: MailMessage): Promise<void> {
+    const { error } = await this.resend.emails.send({
+      from: 'HeatSync Alerts <onboarding@resend.dev>', // Default Resend sender
+      ...message,
+    });
+    if (error) {
+      throw new Error(error.message);
+    }
+  }
+}
+
+// Local fake mail sink: appends every message as a JSON line to a file
+export class FileSinkTransport implements MailTransport {
+  constructor(private readonly path: string) {}
+
+  async send(message: MailMessage): Promise<void> {
+    await appendFile(
+      this.path,
+      JSON.stringify({ ...message, sentAt: new Date().toISOString() }) + '\n',
+    );
+  }
+}
@@ -9,6 +9,9 @@ import { SupabaseModule } from './auth/supabase.module';
 import { DevicesModule } from './devices/devices.module';
 import { LocationsModule } from './locations/locations.module';
 import { AlertsModule } from './alerts/alerts.module';
+import { ExportModule } from './export/export.module';
+import { MetricsModule } from './metrics/metrics.module';
+import { ClusterModule } from './cluster/cluster.module';
 
 @Module({
   imports: [
@@ -22,6 +25,9 @@ import { AlertsModule } from './alerts/alerts.module';
     DevicesModule,
     LocationsModule,
     AlertsModule,
+    ExportModule,
+    MetricsModule,
+    ClusterModule,
   ],
   controllers: [AppController],
   providers: [AppService, MqttService],
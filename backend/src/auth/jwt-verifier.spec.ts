@@ -0,0 +1,112 @@
+import { generateKeyPairSync, KeyObject, sign } from 'crypto';
+import {
+  Jwk,
+  JwtVerificationError,
+  JwtVerifier,
+  SigningKeyUnavailableError,
+} from './jwt-verifier';
+
+const ISSUER = 'http://127.0.0.1:54321/auth/v1';
+
+// Stands in for the auth server: an EC key pair published as a JWKS
+function createSigningKey(kid: string) {
+  const { publicKey, privateKey } = generateKeyPairSync('ec', {
+    namedCurve: 'P-256',
+  });
+  const jwk: Jwk = { ...publicKey.export({ format: 'jwk' }), kid, use: 'sig' };
+  return { kid, jwk, privateKey };
+}
+
+function signToken(
+  key: { kid: string; privateKey: KeyObject },
+  claims: Record<string, unknown> = {},
+) {
+  const encode = (value: object) =>
+    Buffer.from(JSON.stringify(value)).toString('base64url');
+  const header = encode({ alg: 'ES256', kid: key.kid, typ: 'JWT' });
+  const payload = encode({
+    sub: 'user-1',
+    iss: ISSUER,
+    aud: 'authenticated',
+    exp: Math.floor(Date.now() / 1000) + 3600,
+    ...claims,
+  });
+  const signature = sign('sha256', Buffer.from(`${header}.${payload}`), {
+    key: key.privateKey,
+    dsaEncoding: 'ieee-p1363',
+  }).toString('base64url');
+  return `${header}.${payload}.${signature}`;
+}
+
+describe('JwtVerifier', () => {
+  let published: Jwk[];
+  let fetchKeys: jest.Mock<Promise<Jwk[]>, []>;
+  let verifier: JwtVerifier;
+  const key = createSigningKey('key-1');
+
+  beforeEach(async () => {
+    published = [key.jwk];
+    fetchKeys = jest.fn(() => Promise.resolve(published));
+    verifier = new JwtVerifier({
+      issuer: ISSUER,
+      audience: 'authenticated',
+      fetchKeys,
+      refreshIntervalMs: 60_000,
+      minRefetchIntervalMs: 0,
+      clockToleranceSec: 0,
+    });
+    await verifier.start();
+  });
+
+  afterEach(() => verifier.stop());
+
+  it('verifies tokens without fetching keys again', async () => {
+    await expect(verifier.verify(signToken(key))).resolves.toMatchObject({
+      sub: 'user-1',
+    });
+    await verifier.verify(signToken(key));
+    expect(fetchKeys).toHaveBeenCalledTimes(1);
+  });
+
+  it('rejects tampered, expired and foreign tokens', async () => {
+    const [header, , signature] = signToken(key).split('.');
+    const forged = Buffer.from(
+      JSON.stringify({ sub: 'admin', iss: ISSUER, exp: 9e9 }),
+    ).toString('base64url');
+
+    for (const token of [
+      `${header}.${forged}.${signature}`,
+      signToken(key, { exp: Math.floor(Date.now() / 1000) - 1 }),
+      signToken(key, { aud: 'anon' }),
+      signToken(key, { iss: 'https://elsewhere/auth/v1' }),
+      'not-a-token',
+    ]) {
+      await expect(verifier.verify(token)).rejects.toThrow(
+        JwtVerificationError,
+      );
+    }
+  });
+
+  it('refetches keys when a token names a rotated key', async () => {
+    const rotated = createSigningKey('key-2');
+    published = [key.jwk, rotated.jwk];
+
+    await expect(verifier.verify(signToken(rotated))).resolves.toBeDefined();
+    expect(fetchKeys).toHaveBeenCalledTimes(2);
+  });
+
+  it('reports missing keys separately from invalid tokens', async () => {
+    const offline = new JwtVerifier({
+      issuer: ISSUER,
+      audience: 'authenticated',
+      fetchKeys: () => Promise.reject(new Error('unreachable')),
+      refreshIntervalMs: 60_000,
+      minRefetchIntervalMs: 0,
+      clockToleranceSec: 0,
+    });
+
+    await expect(offline.verify(signToken(key))).rejects.toThrow(
+      SigningKeyUnavailableError,
+    );
+  });
+});
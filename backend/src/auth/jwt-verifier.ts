@@ -0,0 +1,217 @@
+import {
+  createHmac,
+  createPublicKey,
+  JsonWebKey,
+  KeyObject,
+  timingSafeEqual,
+  verify,
+} from 'crypto';
+
+export interface Jwk extends JsonWebKey {
+  kid?: string;
+  alg?: string;
+  use?: string;
+}
+
+export interface JwtClaims {
+  sub: string;
+  exp: number;
+  iat?: number;
+  nbf?: number;
+  iss?: string;
+  aud?: string | string[];
+  email?: string;
+  phone?: string;
+  role?: string;
+  is_anonymous?: boolean;
+  app_metadata?: Record<string, unknown>;
+  user_metadata?: Record<string, unknown>;
+}
+
+export interface JwtVerifierOptions {
+  issuer: string;
+  audience: string;
+  // Returns the current signing keys, e.g. from the JWKS endpoint
+  fetchKeys: () => Promise<Jwk[]>;
+  refreshIntervalMs: number;
+  // An unknown key id refetches the keys at most once per this window
+  minRefetchIntervalMs: number;
+  clockToleranceSec: number;
+  // Shared secret for projects that still sign with HS256
+  hmacSecret?: string;
+}
+
+export class JwtVerificationError extends Error {}
+
+// Thrown when the token may be valid but no key is available to check it
+export class SigningKeyUnavailableError extends JwtVerificationError {}
+
+const ASYMMETRIC_ALGORITHMS: Record<
+  string,
+  { keyType: string; dsaEncoding?: 'ieee-p1363' }
+> = {
+  ES256: { keyType: 'ec', dsaEncoding: 'ieee-p1363' },
+  RS256: { keyType: 'rsa' },
+};
+
+/**
+ * Verifies access tokens against signing keys held in memory, so checking
+ * a token needs no call to the auth server. Keys are refreshed in the
+ * background and refetched early when a token names an unknown key id,
+ * which is what happens right after the auth server rotates its keys.
+ */
+export class JwtVerifier {
+  private keys = new Map<string, KeyObject>();
+  private loaded = false;
+  private lastFetchAt = 0;
+  private fetching: Promise<void> | null = null;
+  private refreshTimer: NodeJS.Timeout | null = null;
+
+  constructor(private readonly options: JwtVerifierOptions) {}
+
+  async start(): Promise<void> {
+    this.refreshTimer = setInterval(
+      () => void this.refresh().catch(() => undefined),
+      this.options.refreshIntervalMs,
+    );
+    this.refreshTimer.unref();
+    await this.refresh();
+  }
+
+  stop(): void {
+    if (this.refreshTimer) clearInterval(this.refreshTimer);
+    this.refreshTimer = null;
+  }
+
+  async verify(token: string): Promise<JwtClaims> {
+    const parts = token.split('.');
+    if (parts.length !== 3) {
+      throw new JwtVerificationError('Malformed token');
+    }
+    const [encodedHeader, encodedPayload, encodedSignature] = parts;
+    const header = decodeSegment<{ alg?: string; kid?: string }>(
+      encodedHeader,
+    );
+    const signed = Buffer.from(`${encodedHeader}.${encodedPayload}`);
+    const signature = Buffer.from(encodedSignature, 'base64url');
+
+    if (header.alg === 'HS256') {
+      this.verifyHmac(signed, signature);
+    } else if (header.alg && ASYMMETRIC_ALGORITHMS[header.alg]) {
+      const key = await this.keyFor(header.kid);
+      const { keyType, dsaEncoding } = ASYMMETRIC_ALGORITHMS[header.alg];
+      if (key.asymmetricKeyType !== keyType) {
+        throw new JwtVerificationError('Key does not match token algorithm');
+      }
+      if (!verify('sha256', signed, { key, dsaEncoding }, signature)) {
+        throw new JwtVerificationError('Invalid signature');
+      }
+    } else {
+      throw new JwtVerificationError(`Unsupported algorithm ${header.alg}`);
+    }
+
+    const claims = decodeSegment<JwtClaims>(encodedPayload);
+    this.checkClaims(claims);
+    return claims;
+  }
+
+  private verifyHmac(signed: Buffer, signature: Buffer) {
+    if (!this.options.hmacSecret) {
+      throw new SigningKeyUnavailableError('No HS256 secret configured');
+    }
+    const expected = createHmac('sha256', this.options.hmacSecret)
+      .update(signed)
+      .digest();
+    if (
+      expected.length !== signature.length ||
+      !timingSafeEqual(expected, signature)
+    ) {
+      throw new JwtVerificationError('Invalid signature');
+    }
+  }
+
+  private checkClaims(claims: JwtClaims) {
+    const now = Date.now() / 1000;
+    const tolerance = this.options.clockToleranceSec;
+
+    if (typeof claims.sub !== 'string' || !claims.sub) {
+      throw new JwtVerificationError('Token has no subject');
+    }
+    if (typeof claims.exp !== 'number' || claims.exp + tolerance < now) {
+      throw new JwtVerificationError('Token expired');
+    }
+    if (claims.nbf !== undefined && claims.nbf - tolerance > now) {
+      throw new JwtVerificationError('Token not yet valid');
+    }
+    if (claims.iss !== this.options.issuer) {
+      throw new JwtVerificationError('Unexpected issuer');
+    }
+    const audiences = Array.isArray(claims.aud) ? claims.aud : [claims.aud];
+    if (!audiences.includes(this.options.audience)) {
+      throw new JwtVerificationError('Unexpected audience');
+    }
+  }
+
+  private async keyFor(kid: string | undefined): Promise<KeyObject> {
+    if (!kid) throw new JwtVerificationError('Token has no key id');
+
+    let key = this.keys.get(kid);
+    if (
+      !key &&
+      Date.now() - this.lastFetchAt >= this.options.minRefetchIntervalMs
+    ) {
+      await this.refresh().catch(() => undefined);
+      key = this.keys.get(kid);
+    }
+    if (key) return key;
+
+    throw this.loaded
+      ? new JwtVerificationError(`Unknown signing key ${kid}`)
+      : new SigningKeyUnavailableError('Signing keys not loaded');
+  }
+
+  // Concurrent callers share one fetch
+  private refresh(): Promise<void> {
+    this.fetching ??= this.loadKeys().finally(() => {
+      this.fetching = null;
+    });
+    return this.fetching;
+  }
+
+  private async loadKeys() {
+    this.lastFetchAt = Date.now();
+    const keys = new Map<string, KeyObject>();
+    for (const jwk of await this.options.fetchKeys()) {
+      if (!jwk.kid || (jwk.use && jwk.use !== 'sig')) continue;
+      try {
+        keys.set(jwk.kid, createPublicKey({ key: jwk, format: 'jwk' }));
+      } catch {
+        // Skip key types this runtime cannot import
+      }
+    }
+    this.keys = keys;
+    this.loaded = true;
+  }
+}
+
+export async function fetchJwks(url: string): Promise<Jwk[]> {
+  const response = await fetch(url, { signal: AbortSignal.timeout(5_000) });
+  if (!response.ok) {
+    throw new Error(`JWKS request failed with ${response.status}`);
+  }
+  const body = (await response.json()) as { keys?: Jwk[] };
+  return body.keys ?? [];
+}
+
+function decodeSegment<T>(segment: string): T {
+  let value: unknown;
+  try {
+    value = JSON.parse(Buffer.from(segment, 'base64url').toString());
+  } catch {
+    throw new JwtVerificationError('Malformed token');
+  }
+  if (typeof value !== 'object' || value === null) {
+    throw new JwtVerificationError('Malformed token');
+  }
+  return value as T;
+}
@@ -1,12 +1,41 @@
-import { Injectable } from '@nestjs/common';
+import {
+  Injectable,
+  Logger,
+  OnModuleDestroy,
+  OnModuleInit,
+} from '@nestjs/common';
 import { ConfigService } from '@nestjs/config';
-import { createClient, SupabaseClient } from '@supabase/supabase-js';
+import { createClient, SupabaseClient, User } from '@supabase/supabase-js';
+import { MetricsService } from '../metrics/metrics.service';
+import {
+  fetchJwks,
+  JwtClaims,
+  JwtVerifier,
+  SigningKeyUnavailableError,
+} from './jwt-verifier';
+import { VerifiedTokenCache } from './verified-token-cache';
+
+const STUB_TOKEN_PREFIX = 'stub:';
 
 @Injectable()
-export class SupabaseService {
+export class SupabaseService implements OnModuleInit, OnModuleDestroy {
   private supabase;
+  // Load tests only: `stub:<user id>` tokens are accepted without Supabase
+  private readonly stubAuth: boolean;
+  // Null when AUTH_LOCAL_VERIFY=false; every token then goes to Supabase
+  private readonly verifier: JwtVerifier | null;
+  private readonly tokenCache: VerifiedTokenCache;
+  private readonly logger = new Logger('SupabaseService');
+
+  constructor(
+    private configService: ConfigService,
+    private metricsService: MetricsService,
+  ) {
+    this.stubAuth = this.configService.get<string>('AUTH_STUB') === 'true';
+    if (this.stubAuth && process.env.NODE_ENV === 'production') {
+      throw new Error('AUTH_STUB must not be enabled in production');
+    }
 
-  constructor(private configService: ConfigService) {
     const supabaseUrl = this.configService.get<string>('SUPABASE_URL');
     const supabaseKey = this.configService.get<string>(
       'SUPABASE_PUBLISHABLE_KEY',
@@ -19,22 +48,116 @@ export class SupabaseService {
     }
 
     this.supabase = createClient(supabaseUrl, supabaseKey);
+
+    this.tokenCache = new VerifiedTokenCache(
+      Number(this.configService.get<string>('AUTH_TOKEN_CACHE_MS') ?? 30_000),
+      10_000,
+    );
+
+    const jwksUrl =
+      this.configService.get<string>('SUPABASE_JWKS_URL') ??
+      `${supabaseUrl}/auth/v1/.well-known/jwks.json`;
+    this.verifier =
+      this.configService.get<string>('AUTH_LOCAL_VERIFY') === 'false'
+        ? null
+        : new JwtVerifier({
+            issuer: `${supabaseUrl}/auth/v1`,
+            audience: 'authenticated',
+            fetchKeys: () => fetchJwks(jwksUrl),
+            refreshIntervalMs: Number(
+              this.configService.get<string>('AUTH_JWKS_REFRESH_MS') ??
+                10 * 60_000,
+            ),
+            minRefetchIntervalMs: 30_000,
+            clockToleranceSec: 30,
+            hmacSecret: this.configService.get<string>('SUPABASE_JWT_SECRET'),
+          });
+  }
+
+  async onModuleInit(): Promise<void> {
+    // If the keys cannot be fetched now, tokens are checked remotely until
+    // the next background refresh succeeds
+    await this.verifier?.start().catch((error: Error) =>
+      this.logger.warn(`Signing keys not loaded: ${error.message}`),
+    );
+  }
+
+  onModuleDestroy(): void {
+    this.verifier?.stop();
   }
 
   getClient(): SupabaseClient {
     return this.supabase;
   }
 
-  async verifyToken(token: string) {
+  async verifyToken(token: string): Promise<User | null> {
+    if (this.stubAuth && token.startsWith(STUB_TOKEN_PREFIX)) {
+      return stubUser(token.slice(STUB_TOKEN_PREFIX.length));
+    }
+
+    const cached = this.tokenCache.get(token);
+    if (cached) {
+      this.recordVerification('cached');
+      return cached;
+    }
+
+    if (this.verifier) {
+      try {
+        const claims = await this.verifier.verify(token);
+        const user = userFromClaims(claims);
+        this.tokenCache.set(token, user, claims.exp * 1000);
+        this.recordVerification('local');
+        return user;
+      } catch (error) {
+        if (!(error instanceof SigningKeyUnavailableError)) {
+          this.recordVerification('rejected');
+          return null;
+        }
+      }
+    }
+
     const {
       data: { user },
       error,
     } = await this.supabase.auth.getUser(token);
 
     if (error || !user) {
+      this.recordVerification('rejected');
       return null;
     }
 
+    this.tokenCache.set(token, user);
+    this.recordVerification('remote');
     return user;
   }
+
+  private recordVerification(result: string) {
+    this.metricsService.authVerifications.inc({ result });
+  }
+}
+
+// Access tokens carry the profile fields the guards and services read
+function userFromClaims(claims: JwtClaims): User {
+  return {
+    id: claims.sub,
+    email: claims.email,
+    phone: claims.phone,
+    role: claims.role,
+    is_anonymous: claims.is_anonymous,
+    aud: 'authenticated',
+    app_metadata: claims.app_metadata ?? {},
+    user_metadata: claims.user_metadata ?? {},
+    created_at: new Date((claims.iat ?? 0) * 1000).toISOString(),
+  };
+}
+
+function stubUser(id: string): User {
+  return {
+    id,
+    email: `${id}@loadtest.local`,
+    aud: 'authenticated',
+    app_metadata: {},
+    user_metadata: {},
+    created_at: new Date(0).toISOString(),
+  };
 }
@@ -0,0 +1,45 @@
+import { User } from '@supabase/supabase-js';
+
+interface Entry {
+  user: User;
+  expiresAt: number;
+}
+
+/**
+ * Remembers recently verified tokens for a short while, so a client that
+ * opens several sockets or fires a burst of requests is verified once.
+ * Entries never outlive the token itself; the oldest entry is evicted
+ * when the cache is full.
+ */
+export class VerifiedTokenCache {
+  private readonly entries = new Map<string, Entry>();
+
+  constructor(
+    private readonly ttlMs: number,
+    private readonly maxEntries: number,
+  ) {}
+
+  get(token: string): User | null {
+    const entry = this.entries.get(token);
+    if (!entry) return null;
+    if (entry.expiresAt <= Date.now()) {
+      this.entries.delete(token);
+      return null;
+    }
+    return entry.user;
+  }
+
+  // `tokenExpiresAt` is the token's own expiry in epoch milliseconds
+  set(token: string, user: User, tokenExpiresAt = Infinity): void {
+    if (this.ttlMs <= 0) return;
+    this.entries.delete(token);
+    if (this.entries.size >= this.maxEntries) {
+      const oldest = this.entries.keys().next().value;
+      if (oldest !== undefined) this.entries.delete(oldest);
+    }
+    this.entries.set(token, {
+      user,
+      expiresAt: Math.min(Date.now() + this.ttlMs, tokenExpiresAt),
+    });
+  }
+}
@@ -0,0 +1,12 @@
+import { Global, Module } from '@nestjs/common';
+import { DbModule } from '../db/db.module';
+import { ClusterService } from './cluster.service';
+
+// Global so caches anywhere can stay coherent across instances
+@Global()
+@Module({
+  imports: [DbModule],
+  providers: [ClusterService],
+  exports: [ClusterService],
+})
+export class ClusterModule {}
@@ -0,0 +1,215 @@
+import {
+  Injectable,
+  Logger,
+  OnModuleDestroy,
+  OnModuleInit,
+} from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { randomUUID } from 'crypto';
+import { sql } from 'drizzle-orm';
+import { Client } from 'pg';
+import { DbClient } from '../db/client';
+import { MetricsService } from '../metrics/metrics.service';
+import { ClusterEnvelope, NotifyBatcher } from './notify-batcher';
+
+// ingest consumes MQTT, dashboard serves HTTP and WebSocket clients
+export type InstanceRole = 'ingest' | 'dashboard';
+
+const CHANNEL = 'heatsync_cluster';
+const RECONNECT_DELAY_MS = 1000;
+
+type Handler = (message: unknown) => void;
+
+/**
+ * Lets several backend processes share live state through Postgres
+ * LISTEN/NOTIFY, so no extra broker is needed. Published messages are
+ * batched for CLUSTER_NOTIFY_INTERVAL_MS into NOTIFY payloads on one
+ * channel; each instance listens on a dedicated connection and skips the
+ * payloads it sent itself. Delivery is best effort: anything published
+ * while an instance's listener is reconnecting is lost to it, which is
+ * why caches resync after a reconnect.
+ *
+ * Disabled unless CLUSTER_MODE=true, in which case publish is a no-op
+ * and the single process holds both roles.
+ */
+@Injectable()
+export class ClusterService implements OnModuleInit, OnModuleDestroy {
+  readonly enabled: boolean;
+  readonly instanceId = randomUUID();
+  private readonly roles: Set<InstanceRole>;
+  private readonly logger = new Logger('ClusterService');
+  private readonly handlers = new Map<string, Handler[]>();
+  private readonly resyncListeners: (() => void)[] = [];
+  private batcher: NotifyBatcher | null = null;
+  private listener: Client | null = null;
+  private reconnectTimer: NodeJS.Timeout | null = null;
+  // Set while the listener is down, until the next successful LISTEN
+  private interrupted = false;
+  private stopped = false;
+
+  constructor(
+    private readonly configService: ConfigService,
+    private readonly dbClient: DbClient,
+    private readonly metricsService: MetricsService,
+  ) {
+    this.enabled = configService.get<string>('CLUSTER_MODE') === 'true';
+
+    const role = configService.get<string>('INSTANCE_ROLE') ?? 'all';
+    this.roles = new Set<InstanceRole>(
+      role === 'all' ? ['ingest', 'dashboard'] : [role as InstanceRole],
+    );
+    if (!this.roles.has('ingest') && !this.roles.has('dashboard')) {
+      throw new Error(
+        `INSTANCE_ROLE must be all, ingest or dashboard, got "${role}"`,
+      );
+    }
+    if (!this.enabled && role !== 'all') {
+      throw new Error('INSTANCE_ROLE requires CLUSTER_MODE=true');
+    }
+  }
+
+  async onModuleInit(): Promise<void> {
+    if (!this.enabled) return;
+
+    this.batcher = new NotifyBatcher(
+      this.instanceId,
+      Number(
+        this.configService.get<string>('CLUSTER_NOTIFY_INTERVAL_MS') ?? 25,
+      ),
+      (payload) => this.notify(payload),
+      (count) =>
+        this.metricsService.clusterMessages.inc(
+          { direction: 'oversized' },
+          count,
+        ),
+    );
+    await this.listen();
+    this.logger.log(
+      `Instance ${this.instanceId} joined the cluster as ${Array.from(this.roles).join('+')}`,
+    );
+  }
+
+  async onModuleDestroy(): Promise<void> {
+    this.stopped = true;
+    if (this.reconnectTimer) clearTimeout(this.reconnectTimer);
+    await this.batcher?.flush();
+    await this.listener?.end().catch(() => undefined);
+  }
+
+  hasRole(role: InstanceRole): boolean {
+    return this.roles.has(role);
+  }
+
+  // Sends `message` to every other instance; a no-op outside cluster mode
+  publish(topic: string, message: unknown): void {
+    if (!this.batcher) return;
+    this.batcher.enqueue(topic, message);
+    this.metricsService.clusterMessages.inc({ direction: 'sent' });
+  }
+
+  subscribe<T>(topic: string, handler: (message: T) => void): void {
+    const handlers = this.handlers.get(topic) ?? [];
+    handlers.push(handler as Handler);
+    this.handlers.set(topic, handlers);
+  }
+
+  // Called after the listener reconnects, when messages may have been lost
+  onResync(listener: () => void): void {
+    this.resyncListeners.push(listener);
+  }
+
+  /**
+   * Keeps a per-instance cache coherent across the cluster. `drop` clears
+   * it for one key, or entirely when given null, and runs here, on other
+   * instances via `topic`, and after a resync. Returns the function local
+   * writers call in place of `drop`.
+   */
+  invalidation<T = null>(
+    topic: string,
+    drop: (key: T | null) => void,
+  ): (key?: T) => void {
+    this.subscribe<T | null>(topic, (key) => drop(key));
+    this.onResync(() => drop(null));
+    return (key?: T) => {
+      drop(key ?? null);
+      this.publish(topic, key ?? null);
+    };
+  }
+
+  private async notify(payload: string) {
+    try {
+      await this.dbClient.db.execute(
+        sql`SELECT pg_notify(${CHANNEL}, ${payload})`,
+      );
+    } catch (error) {
+      this.metricsService.clusterMessages.inc({ direction: 'send_failed' });
+      this.logger.error(`Failed to publish cluster notification: ${error}`);
+    }
+  }
+
+  // LISTEN needs a session, so it cannot go through a transaction-mode
+  // pooler; CLUSTER_DATABASE_URL can point at a direct connection instead
+  private async listen() {
+    const client = new Client({
+      connectionString:
+        this.configService.get<string>('CLUSTER_DATABASE_URL') ??
+        this.configService.get<string>('DATABASE_URL'),
+    });
+    this.listener = client;
+    client.on('notification', ({ channel, payload }) => {
+      if (channel === CHANNEL && payload) this.receive(payload);
+    });
+    client.on('error', (error) => this.reconnect(client, error));
+    client.on('end', () => this.reconnect(client));
+
+    try {
+      await client.connect();
+      await client.query(`LISTEN ${CHANNEL}`);
+    } catch (error) {
+      this.reconnect(client, error);
+      return;
+    }
+
+    if (this.interrupted) {
+      this.interrupted = false;
+      this.logger.log('Cluster listener reconnected, resyncing caches');
+      this.resyncListeners.forEach((listener) => listener());
+    }
+  }
+
+  private reconnect(client: Client, error?: unknown) {
+    if (this.stopped || this.listener !== client) return;
+    this.listener = null;
+    this.interrupted = true;
+    this.logger.warn(
+      `Cluster listener disconnected${error ? `: ${error}` : ''}`,
+    );
+    client.end().catch(() => undefined);
+    this.reconnectTimer = setTimeout(() => {
+      this.reconnectTimer = null;
+      void this.listen();
+    }, RECONNECT_DELAY_MS);
+  }
+
+  private receive(payload: string) {
+    let envelope: ClusterEnvelope;
+    try {
+      envelope = JSON.parse(payload) as ClusterEnvelope;
+    } catch {
+      this.logger.warn('Ignoring malformed cluster notification');
+      return;
+    }
+    if (envelope.origin === this.instanceId) return;
+
+    for (const [topic, message] of envelope.messages) {
+      this.metricsService.clusterMessages.inc({ direction: 'received' });
+      for (const handler of this.handlers.get(topic) ?? []) {
+        try {
+          handler(message);
+        } catch (error) {
+          this.logger.error(`Cluster handler for ${topic} failed: ${error}`);
+        }
+      }
+    }
+  }
+}
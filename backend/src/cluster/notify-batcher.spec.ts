@@ -0,0 +1,72 @@
+import {
+  ClusterEnvelope,
+  NotifyBatcher,
+  packEnvelopes,
+} from './notify-batcher';
+
+describe('packEnvelopes', () => {
+  const reading = (i: number): [string, unknown] => [
+    'telemetry',
+    { deviceId: `device-${i}`, temperature: 20 + i / 10 },
+  ];
+
+  it('splits messages across payloads under the size limit, in order', () => {
+    const messages = Array.from({ length: 200 }, (_, i) => reading(i));
+    const { payloads, oversized } = packEnvelopes('a', messages, 1000);
+
+    expect(oversized).toBe(0);
+    expect(payloads.length).toBeGreaterThan(1);
+    for (const payload of payloads) {
+      expect(Buffer.byteLength(payload)).toBeLessThanOrEqual(1000);
+    }
+
+    const unpacked = payloads.flatMap(
+      (payload) => (JSON.parse(payload) as ClusterEnvelope).messages,
+    );
+    expect(unpacked).toEqual(messages);
+  });
+
+  it('drops messages that cannot fit in any payload', () => {
+    const big: [string, unknown] = ['telemetry', 'x'.repeat(2000)];
+    const { payloads, oversized } = packEnvelopes(
+      'a',
+      [reading(1), big, reading(2)],
+      1000,
+    );
+
+    expect(oversized).toBe(1);
+    expect(payloads).toHaveLength(1);
+    expect((JSON.parse(payloads[0]) as ClusterEnvelope).messages).toEqual([
+      reading(1),
+      reading(2),
+    ]);
+  });
+});
+
+describe('NotifyBatcher', () => {
+  it('batches messages enqueued within an interval', async () => {
+    const sent: string[] = [];
+    const batcher = new NotifyBatcher(
+      'origin',
+      1000,
+      (payload) => {
+        sent.push(payload);
+        return Promise.resolve();
+      },
+      () => undefined,
+    );
+
+    batcher.enqueue('telemetry', 1);
+    batcher.enqueue('devices:snapshot', null);
+    await batcher.flush();
+
+    expect(sent).toHaveLength(1);
+    expect(JSON.parse(sent[0])).toEqual({
+      origin: 'origin',
+      messages: [
+        ['telemetry', 1],
+        ['devices:snapshot', null],
+      ],
+    });
+  });
+});
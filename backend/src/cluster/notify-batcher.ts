@@ -0,0 +1,90 @@
+// Postgres rejects NOTIFY payloads of 8000 bytes or more
+export const MAX_NOTIFY_BYTES = 7900;
+
+// One NOTIFY payload: messages from a single instance, in publish order
+export interface ClusterEnvelope {
+  origin: string;
+  messages: [topic: string, message: unknown][];
+}
+
+/**
+ * Packs messages into as few envelopes as fit under `maxBytes` each,
+ * keeping their order. Messages too large for any envelope are returned
+ * in `oversized` instead.
+ */
+export function packEnvelopes(
+  origin: string,
+  messages: [string, unknown][],
+  maxBytes = MAX_NOTIFY_BYTES,
+): { payloads: string[]; oversized: number } {
+  const head = `{"origin":${JSON.stringify(origin)},"messages":[`;
+  const tail = ']}';
+  const empty = Buffer.byteLength(head) + tail.length;
+
+  const payloads: string[] = [];
+  let oversized = 0;
+  let current: string[] = [];
+  let size = empty;
+
+  for (const message of messages) {
+    const encoded = JSON.stringify(message);
+    const bytes = Buffer.byteLength(encoded);
+    if (empty + bytes > maxBytes) {
+      oversized++;
+      continue;
+    }
+    // Each message after the first also needs a comma
+    if (current.length > 0 && size + bytes + 1 > maxBytes) {
+      payloads.push(head + current.join(',') + tail);
+      current = [];
+      size = empty;
+    }
+    size += bytes + (current.length > 0 ? 1 : 0);
+    current.push(encoded);
+  }
+  if (current.length > 0) payloads.push(head + current.join(',') + tail);
+
+  return { payloads, oversized };
+}
+
+/**
+ * Collects published messages for `intervalMs` and hands them to `send`
+ * as packed NOTIFY payloads. Sends are chained, so payloads go out in
+ * order even when one round is slower than the interval.
+ */
+export class NotifyBatcher {
+  private pending: [string, unknown][] = [];
+  private timer: NodeJS.Timeout | null = null;
+  private sending: Promise<void> = Promise.resolve();
+
+  constructor(
+    private readonly origin: string,
+    private readonly intervalMs: number,
+    private readonly send: (payload: string) => Promise<void>,
+    private readonly onOversized: (count: number) => void,
+  ) {}
+
+  enqueue(topic: string, message: unknown): void {
+    this.pending.push([topic, message]);
+    if (!this.timer) {
+      this.timer = setTimeout(() => void this.flush(), this.intervalMs);
+    }
+  }
+
+  flush(): Promise<void> {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+    if (this.pending.length === 0) return this.sending;
+
+    const { payloads, oversized } = packEnvelopes(this.origin, this.pending);
+    this.pending = [];
+    if (oversized > 0) this.onOversized(oversized);
+
+    this.sending = this.sending.then(async () => {
+      for (const payload of payloads) await this.send(payload);
+    });
+    return this.sending;
+  }
+}
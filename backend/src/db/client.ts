@@ -1,25 +1,134 @@
-import { Injectable, OnModuleInit } from '@nestjs/common';
+import { Injectable, OnModuleDestroy, OnModuleInit } from '@nestjs/common';
 import { ConfigService } from '@nestjs/config';
+import { SQL } from 'drizzle-orm';
 import { drizzle } from 'drizzle-orm/node-postgres';
-import { Pool } from 'pg';
+import { PgDialect } from 'drizzle-orm/pg-core';
+import { Pool, QueryResultRow } from 'pg';
+import { MetricsService } from '../metrics/metrics.service';
 
 @Injectable()
-export class DbClient implements OnModuleInit {
+export class DbClient implements OnModuleInit, OnModuleDestroy {
   private pool!: Pool;
   private _db = null as ReturnType<typeof drizzle> | null;
+  private readonly dialect = new PgDialect();
 
-  constructor(private readonly configService: ConfigService) {}
+  constructor(
+    private readonly configService: ConfigService,
+    private readonly metricsService: MetricsService,
+  ) {}
 
   onModuleInit(): void {
     const databaseUrl = this.configService.get<string>('DATABASE_URL');
     this.pool = new Pool({ connectionString: databaseUrl });
+    this.instrument(this.pool);
     this._db = drizzle(this.pool);
   }
 
+  async onModuleDestroy(): Promise<void> {
+    await this.pool?.end();
+  }
+
   get db() {
     if (!this._db) {
       throw new Error('Database not initialized');
     }
     return this._db;
   }
+
+  /**
+   * Runs `query` through a server-side cursor on a dedicated connection and
+   * yields rows in batches of `batchSize`, so large result sets are never
+   * materialized in memory. The cursor is closed if the consumer stops early.
+   */
+  async *cursor<T extends QueryResultRow>(
+    query: SQL,
+    batchSize = 1000,
+  ): AsyncGenerator<T[]> {
+    const { sql: text, params } = this.dialect.sqlToQuery(query);
+    const acquired = this.metricsService.dbAcquireSeconds.startTimer();
+    const client = await this.pool.connect();
+    acquired();
+    let open = false;
+
+    try {
+      // DECLARE cannot take bind parameters, so inline them as literals
+      const inlined = text.replace(/\$(\d+)/g, (_, index: string) => {
+        const value = params[Number(index) - 1];
+        if (value === null || value === undefined) return 'NULL';
+        return client.escapeLiteral(
+          value instanceof Date ? value.toISOString() : String(value),
+        );
+      });
+
+      await client.query('BEGIN READ ONLY');
+      open = true;
+      await client.query(
+        `DECLARE stream_cursor NO SCROLL CURSOR FOR ${inlined}`,
+      );
+
+      while (true) {
+        const { rows } = await client.query<T>(
+          `FETCH ${batchSize} FROM stream_cursor`,
+        );
+        if (rows.length === 0) break;
+        yield rows;
+        if (rows.length < batchSize) break;
+      }
+
+      await client.query('COMMIT');
+      open = false;
+    } finally {
+      if (open) {
+        await client.query('ROLLBACK').catch(() => undefined);
+      }
+      client.release();
+    }
+  }
+
+  /**
+   * Runs `fn` while holding the session advisory lock named `key`, or
+   * skips it and resolves to false when another session holds the lock.
+   * Keeps jobs that every instance schedules to one run at a time.
+   */
+  async withTryLock(key: string, fn: () => Promise<void>): Promise<boolean> {
+    const acquired = this.metricsService.dbAcquireSeconds.startTimer();
+    const client = await this.pool.connect();
+    acquired();
+
+    try {
+      const { rows } = await client.query<{ locked: boolean }>(
+        'SELECT pg_try_advisory_lock(hashtext($1)) AS locked',
+        [key],
+      );
+      if (!rows[0].locked) return false;
+      try {
+        await fn();
+      } finally {
+        await client.query('SELECT pg_advisory_unlock(hashtext($1))', [key]);
+      }
+      return true;
+    } finally {
+      client.release();
+    }
+  }
+
+  // Times every pooled query (drizzle goes through pool.query) and exposes
+  // the pool's connection counts at scrape time
+  private instrument(pool: Pool) {
+    const query = pool.query.bind(pool) as (...args: unknown[]) => unknown;
+    pool.query = ((...args: unknown[]) => {
+      const done = this.metricsService.dbQuerySeconds.startTimer();
+      const result = query(...args);
+      if (result instanceof Promise) return result.finally(done);
+      done();
+      return result;
+    }) as Pool['query'];
+
+    const connections = this.metricsService.dbPoolConnections;
+    connections.collect(() => {
+      connections.set(pool.totalCount - pool.idleCount, { state: 'active' });
+      connections.set(pool.idleCount, { state: 'idle' });
+      connections.set(pool.waitingCount, { state: 'waiting' });
+    });
+  }
 }
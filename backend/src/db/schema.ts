@@ -9,6 +9,8 @@ import {
   boolean,
   uuid,
   integer,
+  uniqueIndex,
+  primaryKey,
 } from 'drizzle-orm/pg-core';
 
 export const locations = pgTable(
@@ -33,6 +35,25 @@ export const locations = pgTable(
   ],
 );
 
+// Every ancestor/descendant pair of the location hierarchy, including each
+// location paired with itself at depth 0, so a subtree is one index range
+export const locationClosure = pgTable(
+  'location_closure',
+  {
+    ancestorId: integer('ancestor_id')
+      .notNull()
+      .references(() => locations.id, { onDelete: 'cascade' }),
+    descendantId: integer('descendant_id')
+      .notNull()
+      .references(() => locations.id, { onDelete: 'cascade' }),
+    depth: integer('depth').notNull(),
+  },
+  (table) => [
+    primaryKey({ columns: [table.ancestorId, table.descendantId] }),
+    index('location_closure_descendant_idx').on(table.descendantId),
+  ],
+);
+
 export const devices = pgTable(
   'devices',
   {
@@ -69,8 +90,20 @@ export const temperatureReadings = pgTable(
     humidity: real('humidity'),
     deviceId: varchar('device_id', { length: 128 }),
     deviceTimestamp: timestamp('device_timestamp', { withTimezone: true }),
+    // Id of the ingest WAL record it came from
+    ingestId: uuid('ingest_id'),
   },
-  (table) => [index('temperature_readings_taken_at_idx').on(table.takenAt)],
+  (table) => [
+    index('temperature_readings_taken_at_idx').on(table.takenAt),
+    index('temperature_readings_device_taken_at_idx').on(
+      table.deviceId,
+      table.takenAt,
+      table.id,
+    ),
+    // Makes WAL replays idempotent. Device clocks cannot serve for this:
+    // they restart near the epoch when a device boots without NTP.
+    uniqueIndex('temperature_readings_ingest_id_idx').on(table.ingestId),
+  ],
 );
 
 export const temperatureAggregates = pgTable(
@@ -88,6 +121,38 @@ export const temperatureAggregates = pgTable(
       table.granularity,
       table.bucketStart,
     ),
+    index('temperature_aggregates_device_bucket_idx').on(
+      table.deviceId,
+      table.granularity,
+      table.bucketStart,
+      table.id,
+    ),
+  ],
+);
+
+// Rollups over every device in a location's subtree, one row per bucket
+export const locationAggregates = pgTable(
+  'location_aggregates',
+  {
+    id: serial('id').primaryKey(),
+    locationId: integer('location_id')
+      .notNull()
+      .references(() => locations.id, { onDelete: 'cascade' }),
+    granularity: varchar('granularity', { length: 8 }).notNull(),
+    bucketStart: timestamp('bucket_start', { withTimezone: true }).notNull(),
+    avgC: real('avg_c').notNull(),
+    minC: real('min_c').notNull(),
+    maxC: real('max_c').notNull(),
+    avgHumidity: real('avg_humidity'),
+    readingCount: integer('reading_count').notNull(),
+    deviceCount: integer('device_count').notNull(),
+  },
+  (table) => [
+    uniqueIndex('location_aggregates_bucket_idx').on(
+      table.locationId,
+      table.granularity,
+      table.bucketStart,
+    ),
   ],
 );
 
@@ -121,3 +186,39 @@ export const alerts = pgTable(
   },
   (table) => [index('alerts_device_idx').on(table.deviceId)],
 );
+
+// Outbox of alert notifications, one row per recipient, delivered by a worker
+export const alertNotifications = pgTable(
+  'alert_notifications',
+  {
+    id: serial('id').primaryKey(),
+    alertId: integer('alert_id')
+      .notNull()
+      .references(() => alerts.id, { onDelete: 'cascade' }),
+    deviceId: varchar('device_id', { length: 128 }),
+    recipient: text('recipient').notNull(),
+    type: varchar('type', { length: 20 }).notNull(),
+    value: real('value').notNull(),
+    minThreshold: real('min_threshold'),
+    maxThreshold: real('max_threshold'),
+    triggeredAt: timestamp('triggered_at', { withTimezone: true }).notNull(),
+    // alert:recipient:hour, so a trigger is never queued twice
+    dedupeKey: varchar('dedupe_key', { length: 255 }).notNull(),
+    // 'pending', 'sent' or 'failed'
+    status: varchar('status', { length: 16 }).notNull().default('pending'),
+    attempts: integer('attempts').notNull().default(0),
+    // Also used as the claim lease while a worker is sending
+    nextAttemptAt: timestamp('next_attempt_at', { withTimezone: true })
+      .notNull()
+      .defaultNow(),
+    lastError: text('last_error'),
+    sentAt: timestamp('sent_at', { withTimezone: true }),
+    createdAt: timestamp('created_at', { withTimezone: true })
+      .notNull()
+      .defaultNow(),
+  },
+  (table) => [
+    uniqueIndex('alert_notifications_dedupe_idx').on(table.dedupeKey),
+    index('alert_notifications_due_idx').on(table.status, table.nextAttemptAt),
+  ],
+);
@@ -0,0 +1,235 @@
+import { Injectable } from '@nestjs/common';
+import { sql } from 'drizzle-orm';
+import { DbClient } from '../db/client';
+import { ClusterService } from '../cluster/cluster.service';
+import { devices, locations, temperatureReadings } from '../db/schema';
+import { Device } from './devices.service';
+
+export interface DeviceSnapshotLocation {
+  id: number;
+  name: string;
+  type: string;
+  description: string | null;
+}
+
+export interface DeviceSnapshot extends Device {
+  currentTemperature: number | null;
+  currentHumidity: number | null;
+  lastReading: Date | null;
+  location: DeviceSnapshotLocation | null;
+}
+
+interface SnapshotEntry {
+  device: Device;
+  temperature: number | null;
+  humidity: number | null;
+  lastReading: Date | null;
+  location: (DeviceSnapshotLocation & { ownerId: string }) | null;
+}
+
+interface SnapshotRow {
+  id: string;
+  name: string;
+  description: string | null;
+  locationId: number | null;
+  isActive: boolean;
+  lastSeenAt: Date | string | null;
+  createdAt: Date | string;
+  updatedAt: Date | string;
+  ownerId: string | null;
+  groupId: string | null;
+  temperatureC: number | null;
+  humidity: number | null;
+  takenAt: Date | string | null;
+  locationName: string | null;
+  locationType: string | null;
+  locationDescription: string | null;
+  locationOwnerId: string | null;
+}
+
+const toDate = (value: Date | string | null) =>
+  value === null ? null : new Date(value);
+
+/**
+ * In-memory snapshot of all active devices with their latest reading and
+ * location, loaded with one lateral-join query. Device and location changes
+ * invalidate it by bumping the version; readings and last-seen times are
+ * patched in place from the ingest path, so a warm dashboard load costs no
+ * database round-trips at all.
+ */
+@Injectable()
+export class DeviceSnapshotService {
+  private version = 0;
+  private entries: Map<string, SnapshotEntry> | null = null;
+  private loading: Promise<Map<string, SnapshotEntry>> | null = null;
+  private readonly invalidationListeners: (() => void)[] = [];
+  private readonly invalidateAll: () => void;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    clusterService: ClusterService,
+  ) {
+    // Device and location writes on any instance reset every snapshot
+    this.invalidateAll = clusterService.invalidation('devices:snapshot', () =>
+      this.reset(),
+    );
+  }
+
+  // For state derived from the snapshot, such as location membership
+  onInvalidate(listener: () => void): void {
+    this.invalidationListeners.push(listener);
+  }
+
+  // Bumped on every invalidation, so dependents can tell a rebuild is due
+  get currentVersion(): number {
+    return this.version;
+  }
+
+  invalidate(): void {
+    this.invalidateAll();
+  }
+
+  async getActive(userId?: string): Promise<DeviceSnapshot[]> {
+    const entries = await this.load();
+
+    return Array.from(entries.values())
+      .sort(
+        (a, b) =>
+          (b.device.lastSeenAt?.getTime() ?? -Infinity) -
+          (a.device.lastSeenAt?.getTime() ?? -Infinity),
+      )
+      .map((entry) => ({
+        ...entry.device,
+        currentTemperature: entry.temperature,
+        currentHumidity: entry.humidity,
+        lastReading: entry.lastReading,
+        // Locations are only visible to their owner
+        location:
+          entry.location && userId && entry.location.ownerId === userId
+            ? {
+                id: entry.location.id,
+                name: entry.location.name,
+                type: entry.location.type,
+                description: entry.location.description,
+              }
+            : null,
+      }));
+  }
+
+  recordReading(
+    deviceId: string,
+    temperature: number,
+    humidity: number | null,
+    takenAt: Date,
+  ): void {
+    const entry = this.entries?.get(deviceId);
+    if (!entry) return;
+
+    entry.temperature = temperature;
+    entry.humidity = humidity;
+    entry.lastReading = takenAt;
+  }
+
+  recordSeen(deviceId: string, seenAt: Date): void {
+    const entry = this.entries?.get(deviceId);
+    if (!entry) return;
+
+    entry.device = { ...entry.device, lastSeenAt: seenAt, updatedAt: seenAt };
+  }
+
+  private reset() {
+    this.version++;
+    this.entries = null;
+    this.loading = null;
+    this.invalidationListeners.forEach((listener) => listener());
+  }
+
+  private load(): Promise<Map<string, SnapshotEntry>> {
+    if (this.entries) return Promise.resolve(this.entries);
+    if (this.loading) return this.loading;
+
+    // Concurrent callers share one query; a result that was invalidated
+    // while in flight is returned but not kept
+    const version = this.version;
+    const loading = this.query().then((entries) => {
+      if (this.version === version) {
+        this.entries = entries;
+        this.loading = null;
+      }
+      return entries;
+    });
+    loading.catch(() => {
+      if (this.loading === loading) this.loading = null;
+    });
+    this.loading = loading;
+    return loading;
+  }
+
+  private async query(): Promise<Map<string, SnapshotEntry>> {
+    const result = await this.dbClient.db.execute<SnapshotRow>(sql`
+      SELECT
+        ${devices.id} AS "id",
+        ${devices.name} AS "name",
+        ${devices.description} AS "description",
+        ${devices.locationId} AS "locationId",
+        ${devices.isActive} AS "isActive",
+        ${devices.lastSeenAt} AS "lastSeenAt",
+        ${devices.createdAt} AS "createdAt",
+        ${devices.updatedAt} AS "updatedAt",
+        ${devices.ownerId} AS "ownerId",
+        ${devices.groupId} AS "groupId",
+        latest.temperature_c AS "temperatureC",
+        latest.humidity AS "humidity",
+        latest.taken_at AS "takenAt",
+        ${locations.name} AS "locationName",
+        ${locations.type} AS "locationType",
+        ${locations.description} AS "locationDescription",
+        ${locations.ownerId} AS "locationOwnerId"
+      FROM ${devices}
+      LEFT JOIN LATERAL (
+        SELECT
+          ${temperatureReadings.temperatureC} AS temperature_c,
+          ${temperatureReadings.humidity} AS humidity,
+          ${temperatureReadings.takenAt} AS taken_at
+        FROM ${temperatureReadings}
+        WHERE ${temperatureReadings.deviceId} = ${devices.id}
+        ORDER BY ${temperatureReadings.takenAt} DESC
+        LIMIT 1
+      ) latest ON TRUE
+      LEFT JOIN ${locations} ON ${locations.id} = ${devices.locationId}
+      WHERE ${devices.isActive} = TRUE
+    `);
+
+    const entries = new Map<string, SnapshotEntry>();
+    for (const row of result.rows) {
+      entries.set(row.id, {
+        device: {
+          id: row.id,
+          name: row.name,
+          description: row.description,
+          locationId: row.locationId,
+          isActive: row.isActive,
+          lastSeenAt: toDate(row.lastSeenAt),
+          createdAt: new Date(row.createdAt),
+          updatedAt: new Date(row.updatedAt),
+          ownerId: row.ownerId,
+          groupId: row.groupId,
+        },
+        temperature: row.temperatureC,
+        humidity: row.humidity,
+        lastReading: toDate(row.takenAt),
+        location:
+          row.locationId !== null && row.locationName !== null
+            ? {
+                id: row.locationId,
+                name: row.locationName,
+                type: row.locationType!,
+                description: row.locationDescription,
+                ownerId: row.locationOwnerId!,
+              }
+            : null,
+      });
+    }
+    return entries;
+  }
+}
@@ -1,5 +1,6 @@
 import { Module } from '@nestjs/common';
 import { DevicesService } from './devices.service';
+import { DeviceSnapshotService } from './device-snapshot.service';
 import { DevicesController } from './devices.controller';
 import { DbModule } from '../db/db.module';
 import { SupabaseModule } from '../auth/supabase.module';
@@ -7,7 +8,7 @@ import { SupabaseModule } from '../auth/supabase.module';
 @Module({
   imports: [DbModule, SupabaseModule],
   controllers: [DevicesController],
-  providers: [DevicesService],
-  exports: [DevicesService],
+  providers: [DevicesService, DeviceSnapshotService],
+  exports: [DevicesService, DeviceSnapshotService],
 })
 export class DevicesModule {}
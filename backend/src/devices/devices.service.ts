@@ -1,7 +1,16 @@
-import { Injectable, NotFoundException } from '@nestjs/common';
-import { eq, desc, and, inArray, sql } from 'drizzle-orm';
+import {
+  Injectable,
+  NotFoundException,
+  OnModuleDestroy,
+  OnModuleInit,
+} from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { eq, desc, and, sql } from 'drizzle-orm';
 import { DbClient } from '../db/client';
+import { ClusterService } from '../cluster/cluster.service';
 import { devices } from '../db/schema';
+import { DeviceSnapshotService } from './device-snapshot.service';
+import { subtreeIds } from '../locations/location-closure';
 
 export interface Device {
   id: string;
@@ -34,8 +43,48 @@ export interface UpdateDeviceDto {
 }
 
 @Injectable()
-export class DevicesService {
-  constructor(private readonly dbClient: DbClient) {}
+export class DevicesService implements OnModuleInit, OnModuleDestroy {
+  private readonly knownDevices = new Set<string>();
+  private readonly pendingLookups = new Map<string, Promise<void>>();
+  private pendingLastSeen = new Map<string, Date>();
+  private flushTimer: NodeJS.Timeout | null = null;
+  private readonly forgetDevice: (deviceId: string) => void;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    private readonly deviceSnapshotService: DeviceSnapshotService,
+    private readonly configService: ConfigService,
+    clusterService: ClusterService,
+  ) {
+    // Another ingest instance may still have a deleted device cached
+    this.forgetDevice = clusterService.invalidation<string>(
+      'devices:known',
+      (deviceId) => {
+        if (deviceId === null) {
+          this.knownDevices.clear();
+          return;
+        }
+        this.knownDevices.delete(deviceId);
+        this.pendingLastSeen.delete(deviceId);
+      },
+    );
+  }
+
+  onModuleInit(): void {
+    const intervalMs = Number(
+      this.configService.get<string>('LAST_SEEN_FLUSH_MS') ?? 5000,
+    );
+    this.flushTimer = setInterval(() => {
+      this.flushLastSeen().catch((error) =>
+        console.error('Failed to flush device last seen times:', error),
+      );
+    }, intervalMs);
+  }
+
+  async onModuleDestroy(): Promise<void> {
+    if (this.flushTimer) clearInterval(this.flushTimer);
+    await this.flushLastSeen();
+  }
 
   async findAll(userId?: string, locationId?: number): Promise<Device[]> {
     const db = this.dbClient.db;
@@ -43,11 +92,9 @@ export class DevicesService {
     const conditions = [];
 
     if (locationId) {
-      const locationIds = await this.getDescendantLocationIds(
-        locationId,
-        userId,
+      conditions.push(
+        sql`${devices.locationId} IN (${subtreeIds(locationId, userId)})`,
       );
-      conditions.push(inArray(devices.locationId, locationIds));
     }
 
     const whereClause =
@@ -105,6 +152,7 @@ export class DevicesService {
       })
       .returning();
 
+    this.deviceSnapshotService.invalidate();
     return result[0] as Device;
   }
 
@@ -124,31 +172,73 @@ export class DevicesService {
       throw new NotFoundException('Device not found');
     }
 
+    this.deviceSnapshotService.invalidate();
     return result[0] as Device;
   }
 
+  /**
+   * Records that a device was seen. Known devices only update an in-memory
+   * map that flushLastSeen() writes in one statement every few seconds;
+   * unknown devices are looked up (and auto-created) once, then cached.
+   */
   async updateLastSeen(deviceId: string): Promise<void> {
-    const db = this.dbClient.db;
+    if (!this.knownDevices.has(deviceId)) {
+      await this.ensureKnown(deviceId);
+    }
 
-    const existing = await this.findById(deviceId);
+    const now = new Date();
+    this.pendingLastSeen.set(deviceId, now);
+    this.deviceSnapshotService.recordSeen(deviceId, now);
+  }
 
-    if (!existing) {
-      await this.create({
-        id: deviceId,
-        name: `Device ${deviceId}`,
-        description: 'Auto-created device',
+  async flushLastSeen(): Promise<void> {
+    if (this.pendingLastSeen.size === 0) return;
+
+    const pending = this.pendingLastSeen;
+    this.pendingLastSeen = new Map();
+
+    const values = Array.from(
+      pending,
+      ([id, seenAt]) => sql`(${id}, ${seenAt.toISOString()}::timestamptz)`,
+    );
+
+    try {
+      await this.dbClient.db.execute(sql`
+        UPDATE ${devices}
+        SET last_seen_at = seen.at, updated_at = seen.at
+        FROM (VALUES ${sql.join(values, sql`, `)}) AS seen(id, at)
+        WHERE ${devices.id} = seen.id
+      `);
+    } catch (error) {
+      // Keep the timestamps for the next flush unless newer ones arrived
+      pending.forEach((seenAt, id) => {
+        if (!this.pendingLastSeen.has(id)) {
+          this.pendingLastSeen.set(id, seenAt);
+        }
       });
-    } else {
-      await db
-        .update(devices)
-        .set({
-          lastSeenAt: new Date(),
-          updatedAt: new Date(),
-        })
-        .where(eq(devices.id, deviceId));
+      throw error;
     }
   }
 
+  private ensureKnown(deviceId: string): Promise<void> {
+    let lookup = this.pendingLookups.get(deviceId);
+    if (!lookup) {
+      lookup = (async () => {
+        const existing = await this.findById(deviceId);
+        if (!existing) {
+          await this.create({
+            id: deviceId,
+            name: `Device ${deviceId}`,
+            description: 'Auto-created device',
+          });
+        }
+        this.knownDevices.add(deviceId);
+      })().finally(() => this.pendingLookups.delete(deviceId));
+      this.pendingLookups.set(deviceId, lookup);
+    }
+    return lookup;
+  }
+
   async delete(deviceId: string): Promise<void> {
     const db = this.dbClient.db;
 
@@ -160,6 +250,9 @@ export class DevicesService {
     if (result.length === 0) {
       throw new NotFoundException('Device not found');
     }
+
+    this.forgetDevice(deviceId);
+    this.deviceSnapshotService.invalidate();
   }
 
   async findByGroup(groupId: string): Promise<Device[]> {
@@ -173,32 +266,4 @@ export class DevicesService {
 
     return result as Device[];
   }
-
-  private async getDescendantLocationIds(
-    locationId: number,
-    userId?: string,
-  ): Promise<number[]> {
-    const db = this.dbClient.db;
-
-    const result = await db.execute(sql`
-      WITH RECURSIVE location_tree AS (
-        -- Base case: the location itself
-        SELECT id
-        FROM "locations"
-        WHERE "id" = ${locationId}
-        ${userId ? sql`AND "ownerId"::text = ${userId}` : sql``}
-        
-        UNION ALL
-        
-        -- Recursive case: all children
-        SELECT l.id
-        FROM "locations" l
-        JOIN location_tree lt ON l."parentId" = lt.id
-        ${userId ? sql`WHERE l."ownerId"::text = ${userId}` : sql``}
-      )
-      SELECT id FROM location_tree;
-    `);
-
-    return result.rows.map((row: { id: string }) => parseInt(row.id, 10));
-  }
 }
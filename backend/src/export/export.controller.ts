@@ -0,0 +1,179 @@
+import {
+  BadRequestException,
+  Controller,
+  Get,
+  Query,
+  Request,
+  Res,
+  UseGuards,
+} from '@nestjs/common';
+import type { Response } from 'express';
+import { once } from 'events';
+import { HttpAuthGuard } from '../auth/http-auth.guard';
+import type { AuthenticatedRequest } from '../auth/http-auth.guard';
+import { AggregateGranularity } from '../temperature/temperature.service';
+import { ExportFilter, ExportService } from './export.service';
+
+const GRANULARITIES: AggregateGranularity[] = ['1m', '5m', '1h', '6h', '1d'];
+
+@Controller('export')
+@UseGuards(HttpAuthGuard)
+export class ExportController {
+  constructor(private readonly exportService: ExportService) {}
+
+  @Get('readings')
+  async exportReadings(
+    @Request() req: AuthenticatedRequest,
+    @Res() res: Response,
+    @Query('from') from: string,
+    @Query('to') to: string,
+    @Query('deviceIds') deviceIds?: string,
+    @Query('locationId') locationId?: string,
+    @Query('format') format = 'csv',
+  ) {
+    const filter = this.parseFilter(req, from, to, deviceIds, locationId);
+    this.assertFormat(format);
+
+    await this.writeCsv(
+      res,
+      `readings_${this.rangeLabel(filter)}.csv`,
+      [
+        'device_id',
+        'taken_at',
+        'temperature_c',
+        'humidity',
+        'device_timestamp',
+      ],
+      () => this.exportService.streamReadings(filter),
+      (r) => [
+        r.deviceId,
+        new Date(r.takenAt).toISOString(),
+        r.temperatureC,
+        r.humidity,
+        r.deviceTimestamp ? new Date(r.deviceTimestamp).toISOString() : null,
+      ],
+    );
+  }
+
+  @Get('aggregates')
+  async exportAggregates(
+    @Request() req: AuthenticatedRequest,
+    @Res() res: Response,
+    @Query('granularity') granularity: AggregateGranularity,
+    @Query('from') from: string,
+    @Query('to') to: string,
+    @Query('deviceIds') deviceIds?: string,
+    @Query('locationId') locationId?: string,
+    @Query('format') format = 'csv',
+  ) {
+    const filter = this.parseFilter(req, from, to, deviceIds, locationId);
+    this.assertFormat(format);
+    if (!GRANULARITIES.includes(granularity)) {
+      throw new BadRequestException('Invalid granularity');
+    }
+
+    await this.writeCsv(
+      res,
+      `aggregates_${granularity}_${this.rangeLabel(filter)}.csv`,
+      ['device_id', 'bucket_start', 'granularity', 'median_c'],
+      () => this.exportService.streamAggregates(filter, granularity),
+      (a) => [
+        a.deviceId,
+        new Date(a.bucketStart).toISOString(),
+        a.granularity,
+        a.medianC,
+      ],
+    );
+  }
+
+  private parseFilter(
+    req: AuthenticatedRequest,
+    from: string,
+    to: string,
+    deviceIds?: string,
+    locationId?: string,
+  ): ExportFilter {
+    const filter: ExportFilter = {
+      userId: req.user!.id,
+      from: new Date(from),
+      to: new Date(to),
+      deviceIds: deviceIds
+        ? deviceIds
+            .split(',')
+            .map((id) => id.trim())
+            .filter(Boolean)
+        : undefined,
+      locationId: locationId ? parseInt(locationId, 10) : undefined,
+    };
+
+    if (isNaN(filter.from.getTime()) || isNaN(filter.to.getTime())) {
+      throw new BadRequestException('from and to must be valid dates');
+    }
+    if (filter.locationId !== undefined && isNaN(filter.locationId)) {
+      throw new BadRequestException('Invalid locationId');
+    }
+
+    return filter;
+  }
+
+  // Only CSV is produced for now; the writer is format-agnostic per batch
+  private assertFormat(format: string) {
+    if (format !== 'csv') {
+      throw new BadRequestException(`Unsupported export format: ${format}`);
+    }
+  }
+
+  private rangeLabel(filter: ExportFilter): string {
+    const day = (date: Date) => date.toISOString().slice(0, 10);
+    return `${day(filter.from)}_${day(filter.to)}`;
+  }
+
+  /**
+   * Streams rows from the database cursor to the response one batch at a
+   * time. The next batch is only fetched once the socket has drained, so a
+   * slow client throttles the cursor instead of growing a buffer.
+   */
+  private async writeCsv<T>(
+    res: Response,
+    filename: string,
+    header: string[],
+    open: () => AsyncGenerator<T[]>,
+    toColumns: (row: T) => (string | number | null)[],
+  ) {
+    const release = this.exportService.acquire();
+
+    try {
+      res.status(200);
+      res.setHeader('Content-Type', 'text/csv; charset=utf-8');
+      res.setHeader(
+        'Content-Disposition',
+        `attachment; filename="${filename}"`,
+      );
+      res.write(header.join(',') + '\n');
+
+      for await (const rows of open()) {
+        let chunk = '';
+        for (const row of rows) {
+          chunk += toColumns(row).map(csvField).join(',') + '\n';
+        }
+        if (!res.write(chunk)) {
+          await Promise.race([once(res, 'drain'), once(res, 'close')]);
+        }
+        if (res.destroyed) return;
+      }
+
+      res.end();
+    } catch (error) {
+      // Headers are already sent, so the only option is to abort the body
+      res.destroy(error instanceof Error ? error : undefined);
+    } finally {
+      release();
+    }
+  }
+}
+
+function csvField(value: string | number | null): string {
+  if (value === null || value === undefined) return '';
+  const text = String(value);
+  return /[",\n\r]/.test(text) ? `"${text.replace(/"/g, '""')}"` : text;
+}
@@ -0,0 +1,12 @@
+import { Module } from '@nestjs/common';
+import { DbModule } from '../db/db.module';
+import { SupabaseModule } from '../auth/supabase.module';
+import { ExportService } from './export.service';
+import { ExportController } from './export.controller';
+
+@Module({
+  imports: [DbModule, SupabaseModule],
+  controllers: [ExportController],
+  providers: [ExportService],
+})
+export class ExportModule {}
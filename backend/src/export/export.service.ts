@@ -0,0 +1,144 @@
+import { HttpException, HttpStatus, Injectable } from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { SQL, sql } from 'drizzle-orm';
+import { DbClient } from '../db/client';
+import {
+  devices,
+  temperatureAggregates,
+  temperatureReadings,
+} from '../db/schema';
+import { subtreeIds } from '../locations/location-closure';
+import { AggregateGranularity } from '../temperature/temperature.service';
+
+export interface ExportFilter {
+  userId: string;
+  from: Date;
+  to: Date;
+  deviceIds?: string[];
+  locationId?: number;
+}
+
+export interface ExportReadingRow {
+  deviceId: string;
+  takenAt: Date;
+  temperatureC: number;
+  humidity: number | null;
+  deviceTimestamp: Date | null;
+}
+
+export interface ExportAggregateRow {
+  deviceId: string;
+  bucketStart: Date;
+  granularity: string;
+  medianC: number;
+}
+
+// Rows fetched per round-trip; also the unit of backpressure to the response
+const EXPORT_BATCH_SIZE = 5000;
+
+@Injectable()
+export class ExportService {
+  private readonly maxConcurrent: number;
+  private active = 0;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    private readonly configService: ConfigService,
+  ) {
+    this.maxConcurrent = Number(
+      this.configService.get<string>('EXPORT_MAX_CONCURRENCY') ?? 2,
+    );
+  }
+
+  /**
+   * Reserves one of the export slots. Every export holds a pooled connection
+   * for its whole duration, so capping them keeps connections free for ingest.
+   * Returns the release callback.
+   */
+  acquire(): () => void {
+    if (this.active >= this.maxConcurrent) {
+      throw new HttpException(
+        'Too many exports in progress, try again later',
+        HttpStatus.TOO_MANY_REQUESTS,
+      );
+    }
+    this.active++;
+    let released = false;
+    return () => {
+      if (!released) {
+        released = true;
+        this.active--;
+      }
+    };
+  }
+
+  streamReadings(filter: ExportFilter): AsyncGenerator<ExportReadingRow[]> {
+    return this.dbClient.cursor<ExportReadingRow>(
+      sql`
+        SELECT
+          ${temperatureReadings.deviceId} AS "deviceId",
+          ${temperatureReadings.takenAt} AS "takenAt",
+          ${temperatureReadings.temperatureC} AS "temperatureC",
+          ${temperatureReadings.humidity} AS "humidity",
+          ${temperatureReadings.deviceTimestamp} AS "deviceTimestamp"
+        FROM ${temperatureReadings}
+        WHERE ${temperatureReadings.deviceId} IN (${this.deviceScope(filter)})
+          AND ${temperatureReadings.takenAt} >= ${filter.from.toISOString()}::timestamptz
+          AND ${temperatureReadings.takenAt} <= ${filter.to.toISOString()}::timestamptz
+        ORDER BY ${temperatureReadings.deviceId}, ${temperatureReadings.takenAt}
+      `,
+      EXPORT_BATCH_SIZE,
+    );
+  }
+
+  streamAggregates(
+    filter: ExportFilter,
+    granularity: AggregateGranularity,
+  ): AsyncGenerator<ExportAggregateRow[]> {
+    return this.dbClient.cursor<ExportAggregateRow>(
+      sql`
+        SELECT
+          ${temperatureAggregates.deviceId} AS "deviceId",
+          ${temperatureAggregates.bucketStart} AS "bucketStart",
+          ${temperatureAggregates.granularity} AS "granularity",
+          ${temperatureAggregates.medianC} AS "medianC"
+        FROM ${temperatureAggregates}
+        WHERE ${temperatureAggregates.deviceId} IN (${this.deviceScope(filter)})
+          AND ${temperatureAggregates.granularity} = ${granularity}
+          AND ${temperatureAggregates.bucketStart} >= ${filter.from.toISOString()}::timestamptz
+          AND ${temperatureAggregates.bucketStart} <= ${filter.to.toISOString()}::timestamptz
+        ORDER BY ${temperatureAggregates.deviceId}, ${temperatureAggregates.bucketStart}
+      `,
+      EXPORT_BATCH_SIZE,
+    );
+  }
+
+  // Devices narrowed to an explicit set and/or the user's location subtree
+  private deviceScope(filter: ExportFilter): SQL {
+    const conditions: SQL[] = [sql`TRUE`];
+
+    if (filter.deviceIds && filter.deviceIds.length > 0) {
+      conditions.push(
+        sql`${devices.id} IN (${sql.join(
+          filter.deviceIds.map((id) => sql`${id}`),
+          sql`, `,
+        )})`,
+      );
+    }
+
+    if (filter.locationId !== undefined) {
+      conditions.push(
+        sql`${devices.locationId} IN (${subtreeIds(
+          filter.locationId,
+          filter.userId,
+        )})`,
+      );
+    }
+
+    return sql`
+      SELECT ${devices.id}
+      FROM ${devices}
+      WHERE ${sql.join(conditions, sql` AND `)}
+    `;
+  }
+}
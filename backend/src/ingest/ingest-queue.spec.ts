@@ -0,0 +1,72 @@
+import { IngestQueue } from './ingest-queue';
+
+interface Job {
+  device: string;
+  n: number;
+}
+
+describe('IngestQueue', () => {
+  // Each job runs until released by the test
+  const start = (capacity: number, concurrency: number) => {
+    const running: { job: Job; finish: () => void }[] = [];
+    const queue = new IngestQueue<Job>(
+      { capacity, concurrency },
+      (job) => job.device,
+      (job) =>
+        new Promise((resolve) => running.push({ job, finish: resolve })),
+    );
+    const finish = async (n: number) => {
+      running.find((run) => run.job.n === n)!.finish();
+      // Let the handler's finally() run
+      await new Promise(setImmediate);
+    };
+    const runningJobs = () => running.map((run) => run.job.n);
+    return { queue, finish, runningJobs };
+  };
+
+  it('runs one job per key at a time, in arrival order', async () => {
+    const { queue, finish, runningJobs } = start(10, 4);
+    queue.offer({ device: 'a', n: 1 });
+    queue.offer({ device: 'a', n: 2 });
+    queue.offer({ device: 'b', n: 3 });
+    queue.offer({ device: 'a', n: 4 });
+
+    expect(runningJobs()).toEqual([1, 3]);
+    expect(queue.depth).toBe(2);
+
+    await finish(1);
+    expect(runningJobs()).toEqual([1, 3, 2]);
+    await finish(2);
+    expect(runningJobs()).toEqual([1, 3, 2, 4]);
+    expect(queue.depth).toBe(0);
+  });
+
+  it('hands free workers to the key that got ready first', async () => {
+    const { queue, finish, runningJobs } = start(10, 1);
+    queue.offer({ device: 'a', n: 1 });
+    queue.offer({ device: 'b', n: 2 });
+    queue.offer({ device: 'a', n: 3 });
+    queue.offer({ device: 'c', n: 4 });
+
+    await finish(1);
+    await finish(2);
+    await finish(4);
+    expect(runningJobs()).toEqual([1, 2, 4, 3]);
+  });
+
+  it('refuses jobs past capacity and reports when it drains', async () => {
+    const { queue, finish } = start(2, 1);
+    queue.offer({ device: 'a', n: 1 });
+    queue.offer({ device: 'a', n: 2 });
+    queue.offer({ device: 'a', n: 3 });
+
+    expect(queue.isFull).toBe(true);
+    expect(queue.offer({ device: 'b', n: 4 })).toBe(false);
+
+    let drained = false;
+    void queue.waitForDepth(1).then(() => (drained = true));
+    await finish(1);
+    expect(drained).toBe(true);
+    expect(queue.offer({ device: 'b', n: 4 })).toBe(true);
+  });
+});
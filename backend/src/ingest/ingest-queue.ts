@@ -0,0 +1,115 @@
+export interface IngestQueueOptions {
+  capacity: number;
+  concurrency: number;
+}
+
+// Array-backed FIFO; shift() on a plain array copies the remaining items
+class Fifo<T> {
+  private items: T[] = [];
+  private head = 0;
+
+  get length(): number {
+    return this.items.length - this.head;
+  }
+
+  push(item: T) {
+    this.items.push(item);
+  }
+
+  shift(): T | undefined {
+    if (this.head === this.items.length) return undefined;
+    const item = this.items[this.head++];
+    // Drop the consumed prefix once it is at least half the array
+    if (this.head * 2 >= this.items.length) {
+      this.items = this.items.slice(this.head);
+      this.head = 0;
+    }
+    return item;
+  }
+}
+
+/**
+ * Bounded work queue with a fixed number of concurrent workers. Jobs with
+ * the same key run one at a time and in arrival order, so readings of one
+ * device are never persisted concurrently, while different devices proceed
+ * in parallel. The handler is expected to catch its own errors.
+ */
+export class IngestQueue<T> {
+  // Waiting jobs per key; a key is present only while it has some
+  private readonly pending = new Map<string, Fifo<T>>();
+  // Keys with waiting jobs and none running, in the order they got ready
+  private readonly ready = new Fifo<string>();
+  private readonly busyKeys = new Set<string>();
+  private size = 0;
+  private active = 0;
+  private waiters: { depth: number; resolve: () => void }[] = [];
+
+  constructor(
+    private readonly options: IngestQueueOptions,
+    private readonly keyOf: (job: T) => string,
+    private readonly handler: (job: T) => Promise<void>,
+  ) {}
+
+  get depth(): number {
+    return this.size;
+  }
+
+  get inFlight(): number {
+    return this.active;
+  }
+
+  get isFull(): boolean {
+    return this.size >= this.options.capacity;
+  }
+
+  offer(job: T): boolean {
+    if (this.isFull) return false;
+    const key = this.keyOf(job);
+    let jobs = this.pending.get(key);
+    if (!jobs) {
+      jobs = new Fifo<T>();
+      this.pending.set(key, jobs);
+      // A busy key is queued again when its running job finishes
+      if (!this.busyKeys.has(key)) this.ready.push(key);
+    }
+    jobs.push(job);
+    this.size++;
+    this.pump();
+    return true;
+  }
+
+  // Resolves once the queue has dropped to `depth` jobs or fewer
+  waitForDepth(depth: number): Promise<void> {
+    if (this.size <= depth) return Promise.resolve();
+    return new Promise((resolve) => this.waiters.push({ depth, resolve }));
+  }
+
+  private pump() {
+    while (this.active < this.options.concurrency && this.ready.length > 0) {
+      const key = this.ready.shift()!;
+      const jobs = this.pending.get(key)!;
+      const job = jobs.shift()!;
+      if (jobs.length === 0) this.pending.delete(key);
+      this.size--;
+      this.busyKeys.add(key);
+      this.active++;
+
+      void this.handler(job).finally(() => {
+        this.busyKeys.delete(key);
+        this.active--;
+        if (this.pending.has(key)) this.ready.push(key);
+        this.pump();
+      });
+    }
+    this.notifyWaiters();
+  }
+
+  private notifyWaiters() {
+    if (this.waiters.length === 0) return;
+    this.waiters = this.waiters.filter((waiter) => {
+      if (this.size > waiter.depth) return true;
+      waiter.resolve();
+      return false;
+    });
+  }
+}
@@ -0,0 +1,81 @@
+import { performance } from 'perf_hooks';
+
+export type IngestStage =
+  | 'parse'
+  | 'spool'
+  | 'dedupe'
+  | 'persist'
+  | 'fanout'
+  | 'alert';
+
+export interface StageStats {
+  count: number;
+  totalMs: number;
+  maxMs: number;
+}
+
+/**
+ * Counters and per-stage latency for the MQTT ingest pipeline. Totals are
+ * cumulative since startup; maxMs is reset by every `snapshot()`.
+ */
+export class IngestStats {
+  received = 0;
+  replayed = 0;
+  processed = 0;
+  parseFailures = 0;
+  duplicates = 0;
+  shed = 0;
+  failed = 0;
+  pauses = 0;
+
+  readonly stages: Record<IngestStage, StageStats> = {
+    parse: { count: 0, totalMs: 0, maxMs: 0 },
+    spool: { count: 0, totalMs: 0, maxMs: 0 },
+    dedupe: { count: 0, totalMs: 0, maxMs: 0 },
+    persist: { count: 0, totalMs: 0, maxMs: 0 },
+    fanout: { count: 0, totalMs: 0, maxMs: 0 },
+    alert: { count: 0, totalMs: 0, maxMs: 0 },
+  };
+
+  constructor(
+    private readonly onRecord?: (stage: IngestStage, ms: number) => void,
+  ) {}
+
+  // Records the time since `startedAt` and returns the current time
+  record(stage: IngestStage, startedAt: number): number {
+    const now = performance.now();
+    const elapsed = now - startedAt;
+    this.onRecord?.(stage, elapsed);
+    const stats = this.stages[stage];
+    stats.count++;
+    stats.totalMs += elapsed;
+    stats.maxMs = Math.max(stats.maxMs, elapsed);
+    return now;
+  }
+
+  snapshot() {
+    const stages = Object.fromEntries(
+      Object.entries(this.stages).map(([stage, stats]) => {
+        const summary = {
+          count: stats.count,
+          avgMs: stats.count > 0 ? stats.totalMs / stats.count : 0,
+          maxMs: stats.maxMs,
+        };
+        stats.maxMs = 0;
+        return [stage, summary];
+      }),
+    );
+
+    return {
+      received: this.received,
+      replayed: this.replayed,
+      processed: this.processed,
+      parseFailures: this.parseFailures,
+      duplicates: this.duplicates,
+      shed: this.shed,
+      failed: this.failed,
+      pauses: this.pauses,
+      stages,
+    };
+  }
+}
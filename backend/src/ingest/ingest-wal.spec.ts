@@ -0,0 +1,80 @@
+import { mkdtemp, readdir, rm } from 'fs/promises';
+import { tmpdir } from 'os';
+import { join } from 'path';
+import { IngestWal } from './ingest-wal';
+
+describe('IngestWal', () => {
+  let dir: string;
+
+  const create = (segmentBytes = 1024 * 1024) =>
+    new IngestWal({
+      dir,
+      segmentBytes,
+      segmentMaxAgeMs: 60_000,
+      flushIntervalMs: 1,
+    });
+
+  beforeEach(async () => {
+    dir = await mkdtemp(join(tmpdir(), 'ingest-wal-'));
+  });
+
+  afterEach(async () => {
+    await rm(dir, { recursive: true, force: true });
+  });
+
+  it('replays records that were never completed', async () => {
+    const wal = create();
+    await wal.open();
+    await wal.append({ payload: '{"a":1}', receivedAt: 1 });
+    await wal.append({ payload: '{"a":2}', receivedAt: 2 });
+    await wal.close();
+
+    const replays = await create().open();
+
+    expect(replays).toHaveLength(1);
+    expect(replays[0].records.map((r) => r.payload)).toEqual([
+      '{"a":1}',
+      '{"a":2}',
+    ]);
+  });
+
+  it('deletes sealed segments once every record is persisted', async () => {
+    const wal = create(1);
+    await wal.open();
+    const entry = await wal.append({ payload: '{}', receivedAt: 1 });
+    wal.complete(entry, true);
+    await wal.close();
+
+    expect(await create().open()).toEqual([]);
+  });
+
+  it('keeps segments with a failed record for the next start', async () => {
+    const wal = create(1);
+    await wal.open();
+    const entry = await wal.append({ payload: '{}', receivedAt: 1 });
+    wal.complete(entry, false);
+    await wal.close();
+
+    expect(await readdir(dir)).toContain(
+      `segment-${String(entry.segment).padStart(10, '0')}.log`,
+    );
+    expect(await create().open()).toHaveLength(1);
+  });
+
+  it('keeps only the failed records of a sealed segment', async () => {
+    const wal = create(1);
+    await wal.open();
+    const entries = await Promise.all(
+      [1, 2, 3].map((n) =>
+        wal.append({ payload: `{"n":${n}}`, receivedAt: n }),
+      ),
+    );
+    entries.forEach((entry, i) => wal.complete(entry, i !== 1));
+    await wal.close();
+
+    const replays = await create().open();
+
+    expect(replays).toHaveLength(1);
+    expect(replays[0].records.map((r) => r.payload)).toEqual(['{"n":2}']);
+  });
+});
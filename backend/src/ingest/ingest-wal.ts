@@ -0,0 +1,250 @@
+import {
+  FileHandle,
+  mkdir,
+  open,
+  readFile,
+  readdir,
+  rename,
+  unlink,
+  writeFile,
+} from 'fs/promises';
+import { join } from 'path';
+
+export interface IngestWalOptions {
+  dir: string;
+  // A segment is sealed once it grows past this size or age
+  segmentBytes: number;
+  segmentMaxAgeMs: number;
+  // Appends arriving within this window share a single fsync
+  flushIntervalMs: number;
+}
+
+export interface WalRecord {
+  // Stored with the reading, so a replayed record is never stored twice.
+  // Absent from records written before ids were introduced.
+  id?: string;
+  payload: string;
+  receivedAt: number;
+}
+
+// One appended record, as reported back to `complete`
+export interface WalEntry {
+  segment: number;
+  line: Buffer;
+}
+
+export interface WalReplayRecord extends WalRecord {
+  entry: WalEntry;
+}
+
+export interface WalSegmentReplay {
+  segment: number;
+  records: WalReplayRecord[];
+}
+
+interface SegmentState {
+  pending: number;
+  // Lines of records that did not reach Postgres
+  failed: Buffer[];
+  sealed: boolean;
+}
+
+interface PendingAppend {
+  line: Buffer;
+  resolve: (entry: WalEntry) => void;
+  reject: (error: Error) => void;
+}
+
+const SEGMENT_PATTERN = /^segment-(\d+)\.log$/;
+
+/**
+ * Append-only spool of received telemetry, split into numbered segment
+ * files of JSON lines. `append` resolves once the record is fsynced, and
+ * callers report each record back with `complete` after it reaches
+ * Postgres. A sealed segment whose records all completed is deleted; one
+ * with failed records is rewritten to hold only those and returned by
+ * `open` on the next start. Segments left by a crash are replayed whole,
+ * so persisting a record must be idempotent.
+ */
+export class IngestWal {
+  private readonly segments = new Map<number, SegmentState>();
+  private buffer: PendingAppend[] = [];
+  private handle: FileHandle | null = null;
+  private current = 0;
+  private currentBytes = 0;
+  private currentOpenedAt = 0;
+  private flushTimer: NodeJS.Timeout | null = null;
+  private flushing: Promise<void> | null = null;
+  private readonly releases = new Set<Promise<void>>();
+
+  constructor(private readonly options: IngestWalOptions) {}
+
+  /**
+   * Returns the records of segments left over from a previous run, which
+   * must be replayed and completed like freshly appended ones.
+   */
+  async open(): Promise<WalSegmentReplay[]> {
+    await mkdir(this.options.dir, { recursive: true });
+
+    const existing = (await readdir(this.options.dir))
+      .map((name) => SEGMENT_PATTERN.exec(name))
+      .filter((match): match is RegExpExecArray => match !== null)
+      .map((match) => Number(match[1]))
+      .sort((a, b) => a - b);
+
+    const replays: WalSegmentReplay[] = [];
+    for (const segment of existing) {
+      const records = parseSegment(
+        segment,
+        await readFile(this.pathOf(segment), 'utf8'),
+      );
+      this.segments.set(segment, {
+        pending: records.length,
+        failed: [],
+        sealed: true,
+      });
+      replays.push({ segment, records });
+      if (records.length === 0) await this.release(segment);
+    }
+
+    await this.rotate((existing.at(-1) ?? 0) + 1);
+    return replays.filter((replay) => replay.records.length > 0);
+  }
+
+  append(record: WalRecord): Promise<WalEntry> {
+    return this.appendLine(Buffer.from(walLine(record)));
+  }
+
+  // For records already encoded with walLine, e.g. by a decode worker
+  appendLine(line: Buffer): Promise<WalEntry> {
+    return new Promise((resolve, reject) => {
+      this.buffer.push({ line, resolve, reject });
+      this.flushTimer ??= setTimeout(() => {
+        this.flushTimer = null;
+        void this.flush();
+      }, this.options.flushIntervalMs);
+    });
+  }
+
+  // `persisted` is false when the record has to be replayed on next start
+  complete({ segment, line }: WalEntry, persisted: boolean): void {
+    const state = this.segments.get(segment);
+    if (!state) return;
+
+    state.pending--;
+    if (!persisted) state.failed.push(line);
+    if (state.sealed && state.pending === 0) {
+      const release = this.release(segment);
+      this.releases.add(release);
+      void release.finally(() => this.releases.delete(release));
+    }
+  }
+
+  async close(): Promise<void> {
+    if (this.flushTimer) {
+      clearTimeout(this.flushTimer);
+      this.flushTimer = null;
+    }
+    await this.flush();
+    await Promise.all(this.releases);
+    await this.handle?.close();
+    this.handle = null;
+  }
+
+  private async flush(): Promise<void> {
+    // Only one write + fsync at a time; later appends wait for the next one
+    while (this.flushing) await this.flushing;
+    if (this.buffer.length === 0 || !this.handle) return;
+
+    const batch = this.buffer;
+    this.buffer = [];
+
+    this.flushing = (async () => {
+      try {
+        const data = Buffer.concat(batch.map((entry) => entry.line));
+        await this.handle!.write(data);
+        await this.handle!.sync();
+        this.currentBytes += data.length;
+        this.segments.get(this.current)!.pending += batch.length;
+        batch.forEach((entry) =>
+          entry.resolve({ segment: this.current, line: entry.line }),
+        );
+      } catch (error) {
+        batch.forEach((entry) => entry.reject(error as Error));
+      }
+
+      if (
+        this.currentBytes >= this.options.segmentBytes ||
+        (this.currentBytes > 0 &&
+          Date.now() - this.currentOpenedAt >= this.options.segmentMaxAgeMs)
+      ) {
+        // On failure keep appending to the current segment
+        await this.rotate(this.current + 1).catch(() => undefined);
+      }
+    })();
+
+    await this.flushing;
+    this.flushing = null;
+  }
+
+  private async rotate(next: number) {
+    const previous = this.handle ? this.current : null;
+
+    const handle = await open(this.pathOf(next), 'a');
+    await this.handle?.close();
+    this.handle = handle;
+    this.current = next;
+    this.currentBytes = 0;
+    this.currentOpenedAt = Date.now();
+    this.segments.set(next, { pending: 0, failed: [], sealed: false });
+
+    if (previous !== null) {
+      const state = this.segments.get(previous)!;
+      state.sealed = true;
+      if (state.pending === 0) await this.release(previous);
+    }
+  }
+
+  private async release(segment: number) {
+    const state = this.segments.get(segment);
+    this.segments.delete(segment);
+    const path = this.pathOf(segment);
+    if (!state?.failed.length) {
+      await unlink(path).catch(() => undefined);
+      return;
+    }
+    // Swapped in by rename, so a crash leaves either version whole. If
+    // that fails the full segment stays, and is replayed whole
+    await writeFile(`${path}.tmp`, Buffer.concat(state.failed), {
+      flush: true,
+    })
+      .then(() => rename(`${path}.tmp`, path))
+      .catch(() => undefined);
+  }
+
+  private pathOf(segment: number) {
+    return join(
+      this.options.dir,
+      `segment-${String(segment).padStart(10, '0')}.log`,
+    );
+  }
+}
+
+export const walLine = (record: WalRecord): string =>
+  JSON.stringify(record) + '\n';
+
+// A crash mid-write can leave a torn last line, which is dropped
+function parseSegment(segment: number, contents: string): WalReplayRecord[] {
+  const records: WalReplayRecord[] = [];
+  for (const line of contents.split('\n')) {
+    if (!line) continue;
+    try {
+      const record = JSON.parse(line) as WalRecord;
+      const entry = { segment, line: Buffer.from(`${line}\n`) };
+      records.push({ ...record, entry });
+    } catch {
+      break;
+    }
+  }
+  return records;
+}
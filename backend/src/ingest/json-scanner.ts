@@ -0,0 +1,380 @@
+const QUOTE = 0x22;
+const BACKSLASH = 0x5c;
+const COMMA = 0x2c;
+const COLON = 0x3a;
+const MINUS = 0x2d;
+const PLUS = 0x2b;
+const DOT = 0x2e;
+const ZERO = 0x30;
+const NINE = 0x39;
+const LOWER_E = 0x65;
+const UPPER_E = 0x45;
+const OPEN_BRACE = 0x7b;
+const CLOSE_BRACE = 0x7d;
+const OPEN_BRACKET = 0x5b;
+const CLOSE_BRACKET = 0x5d;
+const LOWER_U = 0x75;
+
+const TRUE = Buffer.from('true');
+const FALSE = Buffer.from('false');
+const NULL = Buffer.from('null');
+
+// Characters allowed after a backslash, besides \u
+const SIMPLE_ESCAPES = new Set(
+  Array.from('"\\/bfnrt', (c) => c.charCodeAt(0)),
+);
+
+// Short strings, such as device ids, are decoded once and then looked up
+// by their bytes
+const MAX_INTERNED_BYTES = 64;
+const MAX_INTERNED = 4096;
+
+// Nesting allowed inside skipped values
+const MAX_DEPTH = 32;
+
+// Below 2^53 and 10^22 both operands are exact, so the division rounds
+// correctly (the fast path of Clinger's algorithm)
+const MAX_EXACT_DIGITS = 15;
+const POWERS_OF_TEN = Array.from({ length: MAX_EXACT_DIGITS + 1 }, (_, i) =>
+  Math.pow(10, i),
+);
+
+export type JsonValueType = 'string' | 'number' | 'other';
+
+interface InternedString {
+  bytes: Buffer;
+  value: string;
+}
+
+// Returned by nextKey once the object is closed
+export const END_OF_OBJECT = -2;
+// Returned by nextKey for keys not in the list
+export const UNKNOWN_KEY = -1;
+
+const isDigit = (byte: number) => byte >= ZERO && byte <= NINE;
+const isHex = (byte: number) =>
+  isDigit(byte) ||
+  (byte >= 0x41 && byte <= 0x46) ||
+  (byte >= 0x61 && byte <= 0x66);
+const isWhitespace = (byte: number) =>
+  byte === 0x20 || byte === 0x0a || byte === 0x0d || byte === 0x09;
+
+/**
+ * Reads one flat JSON object straight from a Buffer, for decoders that
+ * know their keys up front. Keys are matched as bytes and values are only
+ * materialized when read, so nothing is allocated for the payload as a
+ * whole. Errors set `failed` and return a placeholder instead of throwing,
+ * keeping the hot path free of exceptions. It accepts exactly what
+ * JSON.parse accepts. Strings that repeat from message to message, like
+ * device ids, are interned so they are not decoded every time.
+ */
+export class JsonScanner {
+  failed = false;
+  private buf: Buffer = Buffer.alloc(0);
+  private pos = 0;
+  private first = true;
+  // Whether the string last found by stringEnd contains escapes
+  private escaped = false;
+  private readonly interned = new Map<number, InternedString>();
+  // Index in the key list where the next key is probably found
+  private nextHint = 0;
+
+  reset(buf: Buffer): this {
+    this.buf = buf;
+    this.pos = 0;
+    this.first = true;
+    this.failed = false;
+    this.nextHint = 0;
+    return this;
+  }
+
+  // Consumes the opening brace of the top-level object
+  begin(): boolean {
+    this.skipWhitespace();
+    if (this.buf[this.pos] !== OPEN_BRACE) return this.fail();
+    this.pos++;
+    return true;
+  }
+
+  /**
+   * Reads the next key and its colon, returning its index in `keys`,
+   * UNKNOWN_KEY, or END_OF_OBJECT after the closing brace.
+   */
+  nextKey(keys: readonly Buffer[]): number {
+    this.skipWhitespace();
+    const buf = this.buf;
+    if (buf[this.pos] === CLOSE_BRACE) {
+      this.pos++;
+      return END_OF_OBJECT;
+    }
+    if (!this.first) {
+      if (buf[this.pos] !== COMMA) return this.failKey();
+      this.pos++;
+      this.skipWhitespace();
+    }
+    this.first = false;
+    if (buf[this.pos] !== QUOTE) return this.failKey();
+
+    const start = this.pos + 1;
+    let index = this.matchKey(start, keys);
+    let end: number;
+    if (index !== UNKNOWN_KEY) {
+      end = start + keys[index].length;
+    } else {
+      end = this.stringEnd(start);
+      if (end < 0) return this.failKey();
+      if (this.escaped) {
+        const key = this.unescape(start, end);
+        index = keys.findIndex((candidate) => candidate.toString() === key);
+      }
+    }
+    this.pos = end + 1;
+
+    this.skipWhitespace();
+    if (buf[this.pos] !== COLON) return this.failKey();
+    this.pos++;
+    this.skipWhitespace();
+    return index;
+  }
+
+  valueType(): JsonValueType {
+    const byte = this.buf[this.pos];
+    if (byte === QUOTE) return 'string';
+    if (byte === MINUS || isDigit(byte)) return 'number';
+    return 'other';
+  }
+
+  readString(): string {
+    const start = this.pos + 1;
+    const end = this.stringEnd(start);
+    if (end < 0) {
+      this.fail();
+      return '';
+    }
+    this.pos = end + 1;
+    if (this.escaped) return this.unescape(start, end);
+    if (end - start > MAX_INTERNED_BYTES) {
+      return this.buf.toString('utf8', start, end);
+    }
+
+    // FNV-1a over the raw bytes
+    let hash = 0x811c9dc5;
+    for (let i = start; i < end; i++) {
+      hash = Math.imul(hash ^ this.buf[i], 0x01000193);
+    }
+    const entry = this.interned.get(hash);
+    if (entry && this.bytesEqual(start, end, entry.bytes)) return entry.value;
+
+    const value = this.buf.toString('utf8', start, end);
+    if (this.interned.size >= MAX_INTERNED) this.interned.clear();
+    this.interned.set(hash, {
+      bytes: Buffer.from(this.buf.subarray(start, end)),
+      value,
+    });
+    return value;
+  }
+
+  readNumber(): number {
+    const buf = this.buf;
+    const start = this.pos;
+    let i = start;
+    const negative = buf[i] === MINUS;
+    if (negative) i++;
+
+    let mantissa = 0;
+    let digits = 0;
+    let scale = 0;
+    if (buf[i] === ZERO) {
+      i++;
+    } else if (isDigit(buf[i])) {
+      while (isDigit(buf[i])) {
+        mantissa = mantissa * 10 + (buf[i++] - ZERO);
+        digits++;
+      }
+    } else {
+      this.fail();
+      return NaN;
+    }
+
+    if (buf[i] === DOT) {
+      i++;
+      if (!isDigit(buf[i])) {
+        this.fail();
+        return NaN;
+      }
+      while (isDigit(buf[i])) {
+        mantissa = mantissa * 10 + (buf[i++] - ZERO);
+        digits++;
+        scale++;
+      }
+    }
+
+    let exact = digits <= MAX_EXACT_DIGITS;
+    if (buf[i] === LOWER_E || buf[i] === UPPER_E) {
+      exact = false;
+      i++;
+      if (buf[i] === PLUS || buf[i] === MINUS) i++;
+      if (!isDigit(buf[i])) {
+        this.fail();
+        return NaN;
+      }
+      while (isDigit(buf[i])) i++;
+    }
+    this.pos = i;
+
+    if (!exact) return Number(buf.toString('latin1', start, i));
+    const value = scale === 0 ? mantissa : mantissa / POWERS_OF_TEN[scale];
+    return negative ? -value : value;
+  }
+
+  // Skips a value of any type, validating it on the way
+  skipValue(depth = 0): void {
+    if (depth > MAX_DEPTH) {
+      this.fail();
+      return;
+    }
+    const buf = this.buf;
+    const byte = buf[this.pos];
+
+    if (byte === QUOTE) {
+      const end = this.stringEnd(this.pos + 1);
+      if (end < 0) this.fail();
+      else this.pos = end + 1;
+    } else if (byte === MINUS || isDigit(byte)) {
+      this.readNumber();
+    } else if (byte === OPEN_BRACE || byte === OPEN_BRACKET) {
+      this.skipContainer(byte === OPEN_BRACE, depth);
+    } else if (
+      !this.literal(TRUE) &&
+      !this.literal(FALSE) &&
+      !this.literal(NULL)
+    ) {
+      this.fail();
+    }
+  }
+
+  // True when nothing but whitespace follows the object
+  end(): boolean {
+    this.skipWhitespace();
+    return !this.failed && this.pos === this.buf.length;
+  }
+
+  /**
+   * Index of the key whose bytes and closing quote follow `start`, trying
+   * the one after the previous match first since senders tend to keep
+   * their key order. Escaped keys are left to the caller.
+   */
+  private matchKey(start: number, keys: readonly Buffer[]): number {
+    for (let n = 0; n < keys.length; n++) {
+      const k = (this.nextHint + n) % keys.length;
+      const key = keys[k];
+      if (
+        this.buf[start + key.length] === QUOTE &&
+        this.bytesEqual(start, start + key.length, key)
+      ) {
+        this.nextHint = k + 1;
+        return k;
+      }
+    }
+    return UNKNOWN_KEY;
+  }
+
+  // Index of the closing quote of the string starting at `start`, or -1
+  private stringEnd(start: number): number {
+    const buf = this.buf;
+    this.escaped = false;
+    for (let i = start; i < buf.length; i++) {
+      const byte = buf[i];
+      if (byte === QUOTE) return i;
+      if (byte < 0x20) return -1;
+      if (byte === BACKSLASH) {
+        this.escaped = true;
+        const next = buf[++i];
+        if (next === LOWER_U) {
+          for (let h = 1; h <= 4; h++) {
+            if (!isHex(buf[i + h])) return -1;
+          }
+          i += 4;
+        } else if (!SIMPLE_ESCAPES.has(next)) {
+          return -1;
+        }
+      }
+    }
+    return -1;
+  }
+
+  // Escapes are rare enough to leave to JSON.parse; stringEnd has
+  // already checked they are valid
+  private unescape(start: number, end: number): string {
+    return JSON.parse(this.buf.toString('utf8', start - 1, end + 1)) as string;
+  }
+
+  private skipContainer(isObject: boolean, depth: number) {
+    const buf = this.buf;
+    const close = isObject ? CLOSE_BRACE : CLOSE_BRACKET;
+    this.pos++;
+    this.skipWhitespace();
+    if (buf[this.pos] === close) {
+      this.pos++;
+      return;
+    }
+
+    while (!this.failed) {
+      if (isObject) {
+        if (buf[this.pos] !== QUOTE) {
+          this.fail();
+          return;
+        }
+        this.skipValue(depth + 1);
+        this.skipWhitespace();
+        if (buf[this.pos] !== COLON) {
+          this.fail();
+          return;
+        }
+        this.pos++;
+        this.skipWhitespace();
+      }
+      this.skipValue(depth + 1);
+      this.skipWhitespace();
+
+      if (buf[this.pos] === close) {
+        this.pos++;
+        return;
+      }
+      if (buf[this.pos] !== COMMA) {
+        this.fail();
+        return;
+      }
+      this.pos++;
+      this.skipWhitespace();
+    }
+  }
+
+  private literal(word: Buffer): boolean {
+    if (!this.bytesEqual(this.pos, this.pos + word.length, word)) return false;
+    this.pos += word.length;
+    return true;
+  }
+
+  private bytesEqual(start: number, end: number, expected: Buffer): boolean {
+    if (end - start !== expected.length || end > this.buf.length) return false;
+    for (let i = 0; i < expected.length; i++) {
+      if (this.buf[start + i] !== expected[i]) return false;
+    }
+    return true;
+  }
+
+  private skipWhitespace() {
+    while (isWhitespace(this.buf[this.pos])) this.pos++;
+  }
+
+  private fail(): false {
+    this.failed = true;
+    return false;
+  }
+
+  private failKey(): number {
+    this.fail();
+    return END_OF_OBJECT;
+  }
+}
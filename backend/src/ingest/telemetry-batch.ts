@@ -0,0 +1,162 @@
+import { walLine } from './ingest-wal';
+import {
+  TelemetryDecodeResult,
+  TemperatureMessage,
+  decodeTelemetry,
+} from './telemetry.generated';
+
+export type TelemetryRejected = Extract<TelemetryDecodeResult, { ok: false }>;
+
+export type DecodedTelemetry =
+  | {
+      ok: true;
+      message: TemperatureMessage;
+      // The message's WAL record, ready to append
+      walLine: Buffer;
+    }
+  | TelemetryRejected;
+
+/**
+ * Raw payloads packed into one buffer, so a batch is handed to a worker
+ * by transferring three ArrayBuffers instead of copying each payload.
+ */
+export interface EncodedBatch {
+  data: ArrayBuffer;
+  // Payload i spans offsets[i] to offsets[i + 1]
+  offsets: Uint32Array;
+  receivedAt: Float64Array;
+  // WAL record ids, copied rather than transferred
+  ids: string[];
+}
+
+/**
+ * Decoded batch in columnar form, which is far cheaper for the receiving
+ * thread to deserialize than one object per message.
+ */
+export interface DecodedBatch {
+  // Null for rejected payloads
+  deviceIds: (string | null)[];
+  // temperature, humidity (NaN when absent) and timestamp per payload
+  values: Float64Array;
+  wal: ArrayBuffer;
+  walOffsets: Uint32Array;
+  rejections: { index: number; rejection: TelemetryRejected }[];
+}
+
+// Messages between TelemetryDecodePool and its workers
+export interface BatchRequest {
+  id: number;
+  batch: EncodedBatch;
+}
+
+export interface BatchResponse {
+  id: number;
+  decoded: DecodedBatch;
+}
+
+const VALUES_PER_MESSAGE = 3;
+
+// Copies into buffers of their own: MQTT payloads are usually slices of
+// a shared socket buffer, which must not be transferred away
+export function encodeBatch(
+  payloads: readonly Buffer[],
+  receivedAt: readonly number[],
+  ids: string[],
+): EncodedBatch {
+  const offsets = new Uint32Array(payloads.length + 1);
+  for (let i = 0; i < payloads.length; i++) {
+    offsets[i + 1] = offsets[i] + payloads[i].length;
+  }
+  const data = new ArrayBuffer(offsets[payloads.length]);
+  const bytes = new Uint8Array(data);
+  payloads.forEach((payload, i) => bytes.set(payload, offsets[i]));
+  return { data, offsets, receivedAt: Float64Array.from(receivedAt), ids };
+}
+
+// Validates every payload and prepares the WAL records of the valid ones
+export function decodeBatch({
+  data,
+  offsets,
+  receivedAt,
+  ids,
+}: EncodedBatch): DecodedBatch {
+  const count = offsets.length - 1;
+  const payloads = Buffer.from(data);
+  const deviceIds: (string | null)[] = new Array(count).fill(null);
+  const values = new Float64Array(count * VALUES_PER_MESSAGE);
+  const rejections: DecodedBatch['rejections'] = [];
+  const lines: string[] = [];
+  const walOffsets = new Uint32Array(count + 1);
+
+  for (let i = 0; i < count; i++) {
+    const payload = payloads.subarray(offsets[i], offsets[i + 1]);
+    const result = decodeTelemetry(payload);
+    let bytes = 0;
+    if (result.ok) {
+      const { deviceId, temperature, humidity, timestamp } = result.message;
+      deviceIds[i] = deviceId;
+      values[i * VALUES_PER_MESSAGE] = temperature;
+      values[i * VALUES_PER_MESSAGE + 1] = humidity ?? NaN;
+      values[i * VALUES_PER_MESSAGE + 2] = timestamp;
+      const line = walLine({
+        id: ids[i],
+        payload: payload.toString(),
+        receivedAt: receivedAt[i],
+      });
+      lines.push(line);
+      bytes = Buffer.byteLength(line);
+    } else {
+      rejections.push({ index: i, rejection: result });
+    }
+    walOffsets[i + 1] = walOffsets[i] + bytes;
+  }
+
+  // Allocated directly rather than from Buffer's shared pool, so it can be
+  // transferred
+  const wal = new ArrayBuffer(walOffsets[count]);
+  const walBytes = Buffer.from(wal);
+  let offset = 0;
+  for (const line of lines) offset += walBytes.write(line, offset);
+
+  return { deviceIds, values, wal, walOffsets, rejections };
+}
+
+export function unpackBatch({
+  deviceIds,
+  values,
+  wal,
+  walOffsets,
+  rejections,
+}: DecodedBatch): DecodedTelemetry[] {
+  const results: DecodedTelemetry[] = new Array(deviceIds.length);
+  for (const { index, rejection } of rejections) results[index] = rejection;
+
+  deviceIds.forEach((deviceId, i) => {
+    if (deviceId === null) return;
+    const humidity = values[i * VALUES_PER_MESSAGE + 1];
+    results[i] = {
+      ok: true,
+      message: {
+        deviceId,
+        temperature: values[i * VALUES_PER_MESSAGE],
+        humidity: Number.isNaN(humidity) ? undefined : humidity,
+        timestamp: values[i * VALUES_PER_MESSAGE + 2],
+      },
+      walLine: Buffer.from(
+        wal,
+        walOffsets[i],
+        walOffsets[i + 1] - walOffsets[i],
+      ),
+    };
+  });
+  return results;
+}
+
+// Every typed array here is created over an ArrayBuffer of its own
+export const batchTransferList = (
+  batch: EncodedBatch | DecodedBatch,
+): ArrayBuffer[] =>
+  ('data' in batch
+    ? [batch.data, batch.offsets.buffer, batch.receivedAt.buffer]
+    : [batch.values.buffer, batch.wal, batch.walOffsets.buffer]
+  ) as ArrayBuffer[];
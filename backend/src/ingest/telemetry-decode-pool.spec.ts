@@ -0,0 +1,77 @@
+import { DecodedTelemetry } from './telemetry-batch';
+import { TelemetryDecodePool } from './telemetry-decode-pool';
+
+const payloads = [
+  '{"deviceId":"a","temperature":21.5,"humidity":40,"timestamp":1}',
+  '{"deviceId":"b","temperature":-3.25,"timestamp":2}',
+  '{"deviceId":"a","temperature":500,"timestamp":3}',
+  'not json',
+].map((payload) => Buffer.from(payload));
+
+// Buffers compare by content once they are strings
+const readable = (result: DecodedTelemetry) =>
+  result.ok ? { ...result, walLine: result.walLine.toString() } : result;
+
+describe('TelemetryDecodePool', () => {
+  let pool: TelemetryDecodePool;
+
+  afterEach(() => pool.close());
+
+  const decodeAll = (count: number) =>
+    Promise.all(
+      Array.from({ length: count }, (_, i) =>
+        pool.decode(payloads[i % payloads.length], 1000 + i, `id-${i}`),
+      ),
+    ).then((results) => results.map(readable));
+
+  it('decodes on the main thread without workers', async () => {
+    pool = new TelemetryDecodePool({ workers: 0, minBatch: 8, maxBatch: 64 });
+
+    expect(await decodeAll(4)).toEqual([
+      {
+        ok: true,
+        message: {
+          deviceId: 'a',
+          temperature: 21.5,
+          humidity: 40,
+          timestamp: 1,
+        },
+        walLine: `${JSON.stringify({
+          id: 'id-0',
+          payload: payloads[0].toString(),
+          receivedAt: 1000,
+        })}\n`,
+      },
+      {
+        ok: true,
+        message: {
+          deviceId: 'b',
+          temperature: -3.25,
+          humidity: undefined,
+          timestamp: 2,
+        },
+        walLine: `${JSON.stringify({
+          id: 'id-1',
+          payload: payloads[1].toString(),
+          receivedAt: 1001,
+        })}\n`,
+      },
+      {
+        ok: false,
+        reason: 'out_of_range',
+        field: 'temperature',
+        deviceId: 'a',
+      },
+      { ok: false, reason: 'malformed', field: null, deviceId: null },
+    ]);
+  });
+
+  it('returns worker results in submission order', async () => {
+    pool = new TelemetryDecodePool({ workers: 0, minBatch: 8, maxBatch: 64 });
+    const expected = await decodeAll(1000);
+    await pool.close();
+
+    pool = new TelemetryDecodePool({ workers: 2, minBatch: 8, maxBatch: 64 });
+    expect(await decodeAll(1000)).toEqual(expected);
+  });
+});
@@ -0,0 +1,181 @@
+import { Logger } from '@nestjs/common';
+import { extname, join } from 'path';
+import { Worker } from 'worker_threads';
+import {
+  BatchRequest,
+  BatchResponse,
+  DecodedTelemetry,
+  batchTransferList,
+  decodeBatch,
+  encodeBatch,
+  unpackBatch,
+} from './telemetry-batch';
+
+export interface TelemetryDecodePoolOptions {
+  // 0 decodes on the calling thread
+  workers: number;
+  // Smaller batches are cheaper to decode than to send to a worker
+  minBatch: number;
+  maxBatch: number;
+}
+
+interface Batch {
+  id: number;
+  // Kept until the results arrive, in case the worker dies
+  payloads: Buffer[];
+  receivedAt: number[];
+  ids: string[];
+  resolvers: ((result: DecodedTelemetry) => void)[];
+  results: DecodedTelemetry[] | null;
+}
+
+// Run from source as well under ts-node and ts-jest
+const WORKER_PATH = join(
+  __dirname,
+  `telemetry-decode.worker${extname(__filename)}`,
+);
+const WORKER_EXEC_ARGV =
+  extname(__filename) === '.ts'
+    ? ['--require', 'ts-node/register/transpile-only']
+    : [];
+
+/**
+ * Decodes and validates telemetry on worker threads, keeping that work
+ * off the event loop that serves WebSocket and HTTP clients. Payloads
+ * submitted in the same turn of the event loop are sent together, up to
+ * `maxBatch`, since a round trip per message would cost the main thread
+ * more than decoding it there; batches under `minBatch` are decoded on the
+ * main thread for the same reason. Results resolve in submission order, so
+ * readings of one device stay in sequence. Batches of a worker that dies
+ * are decoded on the main thread instead.
+ */
+export class TelemetryDecodePool {
+  private readonly logger = new Logger('TelemetryDecodePool');
+  private readonly workers: Worker[] = [];
+  // Batches sent to each worker and not yet returned
+  private readonly assigned = new Map<Worker, Map<number, Batch>>();
+  // Dispatched batches, oldest first, until their results are delivered
+  private readonly inFlight: Batch[] = [];
+  private pending: Batch;
+  private dispatchTimer: NodeJS.Immediate | null = null;
+  private nextId = 0;
+  private nextWorker = 0;
+  private closed = false;
+
+  constructor(private readonly options: TelemetryDecodePoolOptions) {
+    this.pending = this.emptyBatch();
+    for (let i = 0; i < options.workers; i++) this.spawn();
+  }
+
+  get size(): number {
+    return this.workers.length;
+  }
+
+  // `id` becomes the id of the message's WAL record
+  decode(
+    payload: Buffer,
+    receivedAt: number,
+    id: string,
+  ): Promise<DecodedTelemetry> {
+    return new Promise((resolve) => {
+      const batch = this.pending;
+      batch.payloads.push(payload);
+      batch.receivedAt.push(receivedAt);
+      batch.ids.push(id);
+      batch.resolvers.push(resolve);
+      if (batch.payloads.length >= this.options.maxBatch) {
+        this.dispatch();
+      } else {
+        this.dispatchTimer ??= setImmediate(() => this.dispatch());
+      }
+    });
+  }
+
+  async close(): Promise<void> {
+    this.closed = true;
+    this.dispatch();
+    await Promise.all(this.workers.map((worker) => worker.terminate()));
+  }
+
+  private dispatch() {
+    if (this.dispatchTimer) {
+      clearImmediate(this.dispatchTimer);
+      this.dispatchTimer = null;
+    }
+    const batch = this.pending;
+    if (batch.payloads.length === 0) return;
+    this.pending = this.emptyBatch();
+    this.inFlight.push(batch);
+
+    if (
+      this.workers.length === 0 ||
+      batch.payloads.length < this.options.minBatch
+    ) {
+      this.decodeLocally(batch);
+      return;
+    }
+    const worker = this.workers[this.nextWorker++ % this.workers.length];
+    this.assigned.get(worker)!.set(batch.id, batch);
+    const encoded = encodeBatch(batch.payloads, batch.receivedAt, batch.ids);
+    const request: BatchRequest = { id: batch.id, batch: encoded };
+    worker.postMessage(request, batchTransferList(encoded));
+  }
+
+  private spawn() {
+    const worker = new Worker(WORKER_PATH, { execArgv: WORKER_EXEC_ARGV });
+    const batches = new Map<number, Batch>();
+    let started = false;
+    this.workers.push(worker);
+    this.assigned.set(worker, batches);
+
+    worker.once('online', () => (started = true));
+    worker.on('message', ({ id, decoded }: BatchResponse) => {
+      const batch = batches.get(id);
+      if (!batch) return;
+      batches.delete(id);
+      this.complete(batch, unpackBatch(decoded));
+    });
+    worker.on('error', (error) => {
+      this.logger.error(`Decode worker failed: ${error.message}`);
+    });
+    worker.on('exit', () => {
+      this.workers.splice(this.workers.indexOf(worker), 1);
+      this.assigned.delete(worker);
+      for (const batch of batches.values()) this.decodeLocally(batch);
+      if (this.closed) return;
+      // One that never started would fail again the same way
+      if (started) {
+        this.spawn();
+      } else if (this.workers.length === 0) {
+        this.logger.error('No decode workers left; decoding on main thread');
+      }
+    });
+  }
+
+  private decodeLocally(batch: Batch) {
+    const encoded = encodeBatch(batch.payloads, batch.receivedAt, batch.ids);
+    this.complete(batch, unpackBatch(decodeBatch(encoded)));
+  }
+
+  private complete(batch: Batch, results: DecodedTelemetry[]) {
+    batch.payloads = [];
+    batch.receivedAt = [];
+    batch.ids = [];
+    batch.results = results;
+    while (this.inFlight[0]?.results) {
+      const { resolvers, results: done } = this.inFlight.shift()!;
+      resolvers.forEach((resolve, i) => resolve(done![i]));
+    }
+  }
+
+  private emptyBatch(): Batch {
+    return {
+      id: this.nextId++,
+      payloads: [],
+      receivedAt: [],
+      ids: [],
+      resolvers: [],
+      results: null,
+    };
+  }
+}
@@ -0,0 +1,14 @@
+import { parentPort } from 'worker_threads';
+import {
+  BatchRequest,
+  BatchResponse,
+  batchTransferList,
+  decodeBatch,
+} from './telemetry-batch';
+
+// Entry point of the TelemetryDecodePool workers
+parentPort!.on('message', ({ id, batch }: BatchRequest) => {
+  const decoded = decodeBatch(batch);
+  const response: BatchResponse = { id, decoded };
+  parentPort!.postMessage(response, batchTransferList(decoded));
+});
@@ -0,0 +1,82 @@
+import { decodeTelemetry } from './telemetry.generated';
+
+const decode = (payload: string) => decodeTelemetry(Buffer.from(payload));
+
+describe('decodeTelemetry', () => {
+  it('decodes a firmware payload', () => {
+    expect(
+      decode(
+        '{"deviceId":"24:6F:28:AA:BB:CC","temperature":23.45,"humidity":40.1,"timestamp":1760000000000}',
+      ),
+    ).toEqual({
+      ok: true,
+      message: {
+        deviceId: '24:6F:28:AA:BB:CC',
+        temperature: 23.45,
+        humidity: 40.1,
+        timestamp: 1760000000000,
+      },
+    });
+  });
+
+  it('skips unknown keys and tolerates whitespace and escapes', () => {
+    const result = decode(
+      ' { "device\\u0049d" : "a\\"b", "extra": {"x": [1, null, true]},' +
+        ' "temperature" : -5e-1 , "timestamp" : 0 } ',
+    );
+    expect(result).toEqual({
+      ok: true,
+      message: {
+        deviceId: 'a"b',
+        temperature: -0.5,
+        humidity: undefined,
+        timestamp: 0,
+      },
+    });
+  });
+
+  it('parses numbers exactly like JSON.parse', () => {
+    for (const value of ['0.1', '23.45', '-0.000123', '1.2345678901234567']) {
+      const result = decode(
+        `{"deviceId":"a","temperature":${value},"timestamp":1}`,
+      );
+      expect(result.ok && result.message.temperature).toBe(
+        JSON.parse(value) as number,
+      );
+    }
+  });
+
+  // Payloads from device "a", with its id first
+  it.each([
+    ['"temperature":5,"timestamp":1,', 'malformed', null],
+    ['"temperature":05,"timestamp":1', 'malformed', null],
+    ['"temperature":5,"t":"\\x","timestamp":1', 'malformed', null],
+    ['"timestamp":1', 'missing_field', 'temperature'],
+    ['"temperature":"20","timestamp":1', 'wrong_type', 'temperature'],
+    ['"temperature":20,"timestamp":1.5', 'wrong_type', 'timestamp'],
+    ['"temperature":500,"timestamp":1', 'out_of_range', 'temperature'],
+    ['"temperature":2,"humidity":-1,"timestamp":1', 'out_of_range', 'humidity'],
+  ])('rejects %s', (fields, reason, field) => {
+    expect(decode(`{"deviceId":"a",${fields}}`)).toEqual({
+      ok: false,
+      reason,
+      field,
+      deviceId: 'a',
+    });
+  });
+
+  it('rejects anything but a single JSON object as malformed', () => {
+    for (const payload of ['[1]', '{"deviceId":"a"}x', '', 'null']) {
+      expect(decode(payload)).toMatchObject({ ok: false, reason: 'malformed' });
+    }
+  });
+
+  it('does not attribute rejections to an invalid device id', () => {
+    expect(decode('{"deviceId":"","temperature":5,"timestamp":1}')).toEqual({
+      ok: false,
+      reason: 'out_of_range',
+      field: 'deviceId',
+      deviceId: null,
+    });
+  });
+});
@@ -0,0 +1,144 @@
+// Generated from schema/telemetry.schema.json by
+// tools/gen-telemetry-schema.ts. Do not edit; run
+// `npm run codegen:telemetry` instead.
+import { END_OF_OBJECT, JsonScanner } from './json-scanner';
+
+export const TELEMETRY_TOPIC = 'heatsync/telemetry';
+
+export interface TemperatureMessage {
+  // Device MAC address or other stable id
+  deviceId: string;
+  // Degrees Celsius
+  temperature: number;
+  // Relative humidity in percent
+  humidity?: number;
+  // Device clock at sampling time, epoch milliseconds
+  timestamp: number;
+}
+
+export type TelemetryRejection =
+  | 'malformed'
+  | 'missing_field'
+  | 'wrong_type'
+  | 'out_of_range';
+
+export type TelemetryDecodeResult =
+  | { ok: true; message: TemperatureMessage }
+  | {
+      ok: false;
+      reason: TelemetryRejection;
+      field: string | null;
+      // The sender, when its id could be read and is valid
+      deviceId: string | null;
+    };
+
+const KEYS = [
+  Buffer.from('deviceId'),
+  Buffer.from('temperature'),
+  Buffer.from('humidity'),
+  Buffer.from('timestamp'),
+];
+
+const scanner = new JsonScanner();
+
+const reject = (
+  reason: TelemetryRejection,
+  field: string | null,
+  deviceId: string | null,
+): TelemetryDecodeResult => ({ ok: false, reason, field, deviceId });
+
+/**
+ * Decodes and validates a TemperatureMessage straight from the MQTT
+ * payload. Unknown keys are skipped; anything JSON.parse would reject
+ * is malformed.
+ */
+export function decodeTelemetry(payload: Buffer): TelemetryDecodeResult {
+  let deviceId: string | undefined;
+  let temperature: number | undefined;
+  let humidity: number | undefined;
+  let timestamp: number | undefined;
+  let wrongType: string | null = null;
+
+  scanner.reset(payload);
+  if (scanner.begin()) {
+    for (;;) {
+      const key = scanner.nextKey(KEYS);
+      if (key === END_OF_OBJECT) break;
+      switch (key) {
+        case 0:
+          if (scanner.valueType() === 'string') {
+            deviceId = scanner.readString();
+          } else {
+            wrongType ??= 'deviceId';
+            scanner.skipValue();
+          }
+          break;
+        case 1:
+          if (scanner.valueType() === 'number') {
+            temperature = scanner.readNumber();
+          } else {
+            wrongType ??= 'temperature';
+            scanner.skipValue();
+          }
+          break;
+        case 2:
+          if (scanner.valueType() === 'number') {
+            humidity = scanner.readNumber();
+          } else {
+            wrongType ??= 'humidity';
+            scanner.skipValue();
+          }
+          break;
+        case 3:
+          if (scanner.valueType() === 'number') {
+            timestamp = scanner.readNumber();
+          } else {
+            wrongType ??= 'timestamp';
+            scanner.skipValue();
+          }
+          break;
+        default:
+          scanner.skipValue();
+      }
+    }
+  }
+
+  const sender =
+    deviceId === undefined || deviceId.length < 1 || deviceId.length > 64
+      ? null
+      : deviceId;
+  if (!scanner.end()) return reject('malformed', null, sender);
+  if (wrongType) return reject('wrong_type', wrongType, sender);
+  if (deviceId === undefined) {
+    return reject('missing_field', 'deviceId', sender);
+  }
+  if (deviceId.length < 1 || deviceId.length > 64) {
+    return reject('out_of_range', 'deviceId', sender);
+  }
+  if (temperature === undefined) {
+    return reject('missing_field', 'temperature', sender);
+  }
+  if (!Number.isFinite(temperature) || temperature < -55 || temperature > 125) {
+    return reject('out_of_range', 'temperature', sender);
+  }
+  if (
+    humidity !== undefined &&
+    (!Number.isFinite(humidity) || humidity < 0 || humidity > 100)
+  ) {
+    return reject('out_of_range', 'humidity', sender);
+  }
+  if (timestamp === undefined) {
+    return reject('missing_field', 'timestamp', sender);
+  }
+  if (!Number.isInteger(timestamp)) {
+    return reject('wrong_type', 'timestamp', sender);
+  }
+  if (!Number.isFinite(timestamp) || timestamp < 0) {
+    return reject('out_of_range', 'timestamp', sender);
+  }
+
+  return {
+    ok: true,
+    message: { deviceId, temperature, humidity, timestamp },
+  };
+}
@@ -0,0 +1,53 @@
+import { SQL, sql } from 'drizzle-orm';
+import { locationClosure, locations } from '../db/schema';
+
+// Ids of a location and all of its descendants, for use in `IN (...)`.
+// Empty when the location does not belong to `ownerId`.
+export function subtreeIds(locationId: number, ownerId?: string): SQL {
+  return sql`
+    SELECT ${locationClosure.descendantId}
+    FROM ${locationClosure}
+    JOIN ${locations} ON ${locations.id} = ${locationClosure.ancestorId}
+    WHERE ${locationClosure.ancestorId} = ${locationId}
+    ${ownerId ? sql`AND ${locations.ownerId}::text = ${ownerId}` : sql``}
+  `;
+}
+
+// Closure rows for a new leaf: one per ancestor of the parent, plus itself
+export function insertLeaf(locationId: number, parentId: number | null): SQL {
+  return sql`
+    INSERT INTO ${locationClosure} ("ancestor_id", "descendant_id", "depth")
+    SELECT "ancestor_id", ${locationId}::integer, "depth" + 1
+    FROM "location_closure"
+    WHERE "descendant_id" = ${parentId}::integer
+    UNION ALL
+    SELECT ${locationId}::integer, ${locationId}::integer, 0
+  `;
+}
+
+// Cuts the links between a subtree and everything above its root
+export function detachSubtree(locationId: number): SQL {
+  return sql`
+    DELETE FROM ${locationClosure}
+    WHERE ${locationClosure.descendantId} IN (
+      SELECT "descendant_id" FROM "location_closure"
+      WHERE "ancestor_id" = ${locationId}
+    )
+    AND ${locationClosure.ancestorId} IN (
+      SELECT "ancestor_id" FROM "location_closure"
+      WHERE "descendant_id" = ${locationId} AND "ancestor_id" <> ${locationId}
+    )
+  `;
+}
+
+// Links every node of a detached subtree to the new parent's ancestors
+export function attachSubtree(locationId: number, parentId: number): SQL {
+  return sql`
+    INSERT INTO ${locationClosure} ("ancestor_id", "descendant_id", "depth")
+    SELECT above.ancestor_id, below.descendant_id, above.depth + below.depth + 1
+    FROM "location_closure" above
+    CROSS JOIN "location_closure" below
+    WHERE above.descendant_id = ${parentId}
+      AND below.ancestor_id = ${locationId}
+  `;
+}
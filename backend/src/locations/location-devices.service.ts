@@ -1,18 +1,21 @@
 import { Injectable, NotFoundException } from '@nestjs/common';
 import { DbClient } from '../db/client';
 import { devices, locations } from '../db/schema';
+import { DeviceSnapshotService } from '../devices/device-snapshot.service';
+import { subtreeIds } from './location-closure';
 import { and, eq, inArray, sql } from 'drizzle-orm';
 
 @Injectable()
 export class LocationDevicesService {
-  constructor(private readonly dbClient: DbClient) {}
+  constructor(
+    private readonly dbClient: DbClient,
+    private readonly deviceSnapshotService: DeviceSnapshotService,
+  ) {}
 
   async getDevicesInLocation(
     locationId: number,
     userId: string,
   ): Promise<{ id: string; name: string; locationId: number | null }[]> {
-    const locationIds = await this.getDescendantLocationIds(locationId, userId);
-
     const db = this.dbClient.db;
     const result = await db
       .select({
@@ -21,7 +24,9 @@ export class LocationDevicesService {
         locationId: devices.locationId,
       })
       .from(devices)
-      .where(inArray(devices.locationId, locationIds));
+      .where(
+        sql`${devices.locationId} IN (${subtreeIds(locationId, userId)})`,
+      );
 
     return result;
   }
@@ -68,32 +73,7 @@ export class LocationDevicesService {
         updatedAt: new Date(),
       })
       .where(inArray(devices.id, deviceIds));
-  }
-
-  private async getDescendantLocationIds(
-    locationId: number,
-    userId: string,
-  ): Promise<number[]> {
-    const db = this.dbClient.db;
-
-    const result = await db.execute(sql`
-      WITH RECURSIVE location_tree AS (
-        -- Base case: the location itself
-        SELECT id
-        FROM "locations"
-        WHERE "id" = ${locationId} AND "ownerId"::text = ${userId}
-        
-        UNION ALL
-        
-        -- Recursive case: all children
-        SELECT l.id
-        FROM "locations" l
-        JOIN location_tree lt ON l."parentId" = lt.id
-        WHERE l."ownerId"::text = ${userId}
-      )
-      SELECT id FROM location_tree;
-    `);
 
-    return result.rows.map((row: { id: string }) => parseInt(row.id, 10));
+    this.deviceSnapshotService.invalidate();
   }
 }
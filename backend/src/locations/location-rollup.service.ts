@@ -0,0 +1,165 @@
+import { Injectable } from '@nestjs/common';
+import { DbClient } from '../db/client';
+import { locations } from '../db/schema';
+import { DeviceSnapshotService } from '../devices/device-snapshot.service';
+import { LocationRollups, LocationStats } from './location-rollups';
+
+export interface LocationSubtree {
+  deviceIds: string[];
+  stats: LocationStats;
+}
+
+interface RollupState {
+  key: string;
+  rollups: LocationRollups;
+  owners: Map<number, string>;
+}
+
+/**
+ * Live per-location statistics, built from the device snapshot and the
+ * location hierarchy and then kept current from the ingest path. It is
+ * rebuilt lazily after a location change or whenever the device snapshot
+ * is invalidated, which covers devices being added, moved or removed.
+ */
+@Injectable()
+export class LocationRollupService {
+  private version = 0;
+  private state: RollupState | null = null;
+  private loading: { key: string; promise: Promise<RollupState> } | null =
+    null;
+
+  private readonly changeListeners: (() => void)[] = [];
+
+  constructor(
+    private readonly dbClient: DbClient,
+    private readonly deviceSnapshotService: DeviceSnapshotService,
+  ) {
+    deviceSnapshotService.onInvalidate(() => this.notifyChange());
+  }
+
+  // Called whenever subtree membership may have changed
+  onChange(listener: () => void): void {
+    this.changeListeners.push(listener);
+  }
+
+  invalidate(): void {
+    this.version++;
+    this.state = null;
+    this.loading = null;
+    this.notifyChange();
+  }
+
+  recordReading(
+    deviceId: string,
+    temperature: number,
+    humidity: number | null,
+    takenAt: Date,
+  ): void {
+    // A stale state is rebuilt from the (already patched) snapshot instead
+    if (this.state?.key !== this.key()) return;
+    this.state.rollups.record(deviceId, temperature, humidity, takenAt);
+  }
+
+  async getStats(userId: string): Promise<LocationStats[]> {
+    const { rollups, owners } = await this.load();
+    const stats: LocationStats[] = [];
+    for (const [locationId, ownerId] of owners) {
+      if (ownerId === userId) stats.push(rollups.get(locationId)!);
+    }
+    return stats;
+  }
+
+  async getLocationStats(
+    locationId: number,
+    userId: string,
+  ): Promise<LocationStats | null> {
+    const { rollups, owners } = await this.load();
+    if (owners.get(locationId) !== userId) return null;
+    return rollups.get(locationId);
+  }
+
+  /**
+   * Member devices and current statistics of each location, skipping
+   * unknown ones and, when `userId` is given, those of other owners.
+   */
+  async getSubtrees(
+    locationIds: number[],
+    userId?: string,
+  ): Promise<Map<number, LocationSubtree>> {
+    const { rollups, owners } = await this.load();
+    const subtrees = new Map<number, LocationSubtree>();
+    for (const locationId of locationIds) {
+      const ownerId = owners.get(locationId);
+      if (!ownerId || (userId && ownerId !== userId)) continue;
+      subtrees.set(locationId, {
+        deviceIds: rollups.members(locationId)!,
+        stats: rollups.get(locationId)!,
+      });
+    }
+    return subtrees;
+  }
+
+  private notifyChange() {
+    this.changeListeners.forEach((listener) => listener());
+  }
+
+  private key() {
+    return `${this.version}:${this.deviceSnapshotService.currentVersion}`;
+  }
+
+  private load(): Promise<RollupState> {
+    const key = this.key();
+    if (this.state?.key === key) return Promise.resolve(this.state);
+    if (this.loading?.key === key) return this.loading.promise;
+
+    // As in DeviceSnapshotService, a result that went stale while in
+    // flight is returned but not kept
+    const promise = this.build(key).then((state) => {
+      if (this.key() === key) this.state = state;
+      return state;
+    });
+    const loading = { key, promise };
+    void promise
+      .catch(() => undefined)
+      .finally(() => {
+        if (this.loading === loading) this.loading = null;
+      });
+    this.loading = loading;
+    return promise;
+  }
+
+  private async build(key: string): Promise<RollupState> {
+    const rows = await this.dbClient.db
+      .select({
+        id: locations.id,
+        parentId: locations.parentId,
+        ownerId: locations.ownerId,
+      })
+      .from(locations);
+    // Read last, so readings recorded while locations loaded are included
+    const snapshot = await this.deviceSnapshotService.getActive();
+
+    const parents = new Map<number, number | null>();
+    const owners = new Map<number, string>();
+    for (const row of rows) {
+      parents.set(row.id, row.parentId);
+      owners.set(row.id, row.ownerId);
+    }
+
+    const devices = snapshot.flatMap((device) =>
+      device.locationId === null
+        ? []
+        : [
+            {
+              id: device.id,
+              locationId: device.locationId,
+              temperature: device.currentTemperature,
+              humidity: device.currentHumidity,
+              lastReading: device.lastReading,
+            },
+          ],
+    );
+
+    return { key, rollups: new LocationRollups(parents, devices), owners };
+  }
+}
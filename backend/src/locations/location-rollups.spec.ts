@@ -0,0 +1,82 @@
+import { LocationRollups, RollupDevice } from './location-rollups';
+
+describe('LocationRollups', () => {
+  // building 1 > floor 2 > rooms 3 and 4
+  const parents = new Map<number, number | null>([
+    [1, null],
+    [2, 1],
+    [3, 2],
+    [4, 2],
+  ]);
+
+  const device = (
+    id: string,
+    locationId: number,
+    temperature: number | null,
+  ): RollupDevice => ({
+    id,
+    locationId,
+    temperature,
+    humidity: null,
+    lastReading: null,
+  });
+
+  const create = () =>
+    new LocationRollups(parents, [
+      device('a', 3, 20),
+      device('b', 3, 22),
+      device('c', 4, 30),
+      device('d', 4, null),
+    ]);
+
+  it('rolls devices up into every ancestor', () => {
+    const rollups = create();
+
+    expect(rollups.get(3)).toMatchObject({
+      deviceCount: 2,
+      reportingCount: 2,
+      avgTemperature: 21,
+      minTemperature: 20,
+      maxTemperature: 22,
+    });
+    expect(rollups.get(1)).toMatchObject({
+      deviceCount: 4,
+      reportingCount: 3,
+      avgTemperature: 24,
+      minTemperature: 20,
+      maxTemperature: 30,
+    });
+  });
+
+  it('updates ancestors incrementally as readings arrive', () => {
+    const rollups = create();
+    const takenAt = new Date('2026-01-01T00:00:00Z');
+
+    rollups.record('d', 26, 40, takenAt);
+    rollups.record('c', 18, null, takenAt);
+
+    expect(rollups.get(4)).toMatchObject({
+      reportingCount: 2,
+      avgTemperature: 22,
+      minTemperature: 18,
+      maxTemperature: 26,
+      avgHumidity: 40,
+      lastReading: takenAt,
+    });
+    // c held the building maximum, so the building is rescanned
+    expect(rollups.get(1)).toMatchObject({
+      reportingCount: 4,
+      avgTemperature: 21.5,
+      minTemperature: 18,
+      maxTemperature: 26,
+    });
+  });
+
+  it('ignores devices outside the known hierarchy', () => {
+    const rollups = create();
+    rollups.record('unknown', 99, null, new Date());
+
+    expect(rollups.get(1)?.maxTemperature).toBe(30);
+    expect(rollups.get(99)).toBeNull();
+  });
+});
@@ -0,0 +1,184 @@
+export interface RollupDevice {
+  id: string;
+  locationId: number;
+  temperature: number | null;
+  humidity: number | null;
+  lastReading: Date | null;
+}
+
+export interface LocationStats {
+  locationId: number;
+  // Devices anywhere in the location's subtree
+  deviceCount: number;
+  // Of those, devices that have reported a temperature
+  reportingCount: number;
+  avgTemperature: number | null;
+  minTemperature: number | null;
+  maxTemperature: number | null;
+  avgHumidity: number | null;
+  lastReading: Date | null;
+}
+
+interface Rollup {
+  devices: Set<string>;
+  count: number;
+  sum: number;
+  humidityCount: number;
+  humiditySum: number;
+  min: number;
+  max: number;
+  lastReading: Date | null;
+}
+
+/**
+ * Current-reading statistics for every location, covering all devices in
+ * its subtree. A reading updates the device's location and each ancestor
+ * in place: sums and counts by the difference from the device's previous
+ * value, min and max by comparison. Only when the device that held the
+ * minimum or maximum moves away from it is that location rescanned.
+ */
+export class LocationRollups {
+  private readonly devices = new Map<string, RollupDevice>();
+  private readonly rollups = new Map<number, Rollup>();
+
+  constructor(
+    private readonly parents: Map<number, number | null>,
+    devices: RollupDevice[],
+  ) {
+    for (const locationId of parents.keys()) {
+      this.rollups.set(locationId, {
+        devices: new Set(),
+        count: 0,
+        sum: 0,
+        humidityCount: 0,
+        humiditySum: 0,
+        min: Infinity,
+        max: -Infinity,
+        lastReading: null,
+      });
+    }
+
+    for (const device of devices) {
+      if (!parents.has(device.locationId)) continue;
+      const copy = { ...device };
+      this.devices.set(copy.id, copy);
+      for (const rollup of this.chain(copy.locationId)) {
+        rollup.devices.add(copy.id);
+        this.apply(rollup, { temperature: null, humidity: null }, copy);
+      }
+    }
+  }
+
+  record(
+    deviceId: string,
+    temperature: number,
+    humidity: number | null,
+    takenAt: Date,
+  ): void {
+    const device = this.devices.get(deviceId);
+    if (!device) return;
+
+    const previous = {
+      temperature: device.temperature,
+      humidity: device.humidity,
+    };
+    device.temperature = temperature;
+    device.humidity = humidity;
+    device.lastReading = takenAt;
+
+    for (const rollup of this.chain(device.locationId)) {
+      this.apply(rollup, previous, device);
+    }
+  }
+
+  get(locationId: number): LocationStats | null {
+    const rollup = this.rollups.get(locationId);
+    if (!rollup) return null;
+
+    return {
+      locationId,
+      deviceCount: rollup.devices.size,
+      reportingCount: rollup.count,
+      avgTemperature: rollup.count > 0 ? rollup.sum / rollup.count : null,
+      minTemperature: rollup.count > 0 ? rollup.min : null,
+      maxTemperature: rollup.count > 0 ? rollup.max : null,
+      avgHumidity:
+        rollup.humidityCount > 0
+          ? rollup.humiditySum / rollup.humidityCount
+          : null,
+      lastReading: rollup.lastReading,
+    };
+  }
+
+  // Devices anywhere in the location's subtree
+  members(locationId: number): string[] | null {
+    const rollup = this.rollups.get(locationId);
+    return rollup ? Array.from(rollup.devices) : null;
+  }
+
+  // The location and its ancestors, bounded in case of a corrupt cycle
+  private *chain(locationId: number): Generator<Rollup> {
+    let id: number | null | undefined = locationId;
+    for (let depth = 0; id != null && depth <= this.parents.size; depth++) {
+      const rollup = this.rollups.get(id);
+      if (!rollup) return;
+      yield rollup;
+      id = this.parents.get(id);
+    }
+  }
+
+  private apply(
+    rollup: Rollup,
+    previous: Pick<RollupDevice, 'temperature' | 'humidity'>,
+    device: RollupDevice,
+  ) {
+    if (previous.humidity !== null) {
+      rollup.humiditySum -= previous.humidity;
+      rollup.humidityCount--;
+    }
+    if (device.humidity !== null) {
+      rollup.humiditySum += device.humidity;
+      rollup.humidityCount++;
+    }
+
+    if (
+      device.lastReading &&
+      (!rollup.lastReading || device.lastReading > rollup.lastReading)
+    ) {
+      rollup.lastReading = device.lastReading;
+    }
+
+    const value = device.temperature;
+    if (value === null) return;
+
+    const old = previous.temperature;
+    if (old === null) {
+      rollup.count++;
+      rollup.sum += value;
+    } else {
+      rollup.sum += value - old;
+    }
+
+    if (
+      old !== null &&
+      old !== value &&
+      (old === rollup.min || old === rollup.max)
+    ) {
+      this.rescanExtremes(rollup);
+    } else {
+      rollup.min = Math.min(rollup.min, value);
+      rollup.max = Math.max(rollup.max, value);
+    }
+  }
+
+  private rescanExtremes(rollup: Rollup) {
+    rollup.min = Infinity;
+    rollup.max = -Infinity;
+    for (const id of rollup.devices) {
+      const temperature = this.devices.get(id)!.temperature;
+      if (temperature === null) continue;
+      rollup.min = Math.min(rollup.min, temperature);
+      rollup.max = Math.max(rollup.max, temperature);
+    }
+  }
+}
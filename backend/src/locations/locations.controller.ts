@@ -11,16 +11,28 @@ import {
   HttpCode,
   HttpStatus,
   ParseIntPipe,
+  Query,
+  BadRequestException,
+  NotFoundException,
 } from '@nestjs/common';
 import { LocationsService } from './locations.service';
 import type { CreateLocationDto, UpdateLocationDto } from './locations.service';
+import { LocationRollupService } from './location-rollup.service';
+import {
+  AggregateGranularity,
+  TemperatureService,
+} from '../temperature/temperature.service';
 import { HttpAuthGuard } from '../auth/http-auth.guard';
 import type { AuthenticatedRequest } from '../auth/http-auth.guard';
 
 @Controller('locations')
 @UseGuards(HttpAuthGuard)
 export class LocationsController {
-  constructor(private readonly locationsService: LocationsService) {}
+  constructor(
+    private readonly locationsService: LocationsService,
+    private readonly locationRollupService: LocationRollupService,
+    private readonly temperatureService: TemperatureService,
+  ) {}
 
   @Get()
   async findAll(@Request() req: AuthenticatedRequest) {
@@ -34,6 +46,60 @@ export class LocationsController {
     return this.locationsService.getTree(userId);
   }
 
+  // Live statistics for every location of the user, one entry each
+  @Get('stats')
+  async getStats(@Request() req: AuthenticatedRequest) {
+    const userId = req.user!.id;
+    return this.locationRollupService.getStats(userId);
+  }
+
+  @Get(':id/stats')
+  async getLocationStats(
+    @Param('id', ParseIntPipe) id: number,
+    @Request() req: AuthenticatedRequest,
+  ) {
+    const userId = req.user!.id;
+    const stats = await this.locationRollupService.getLocationStats(
+      id,
+      userId,
+    );
+    if (!stats) {
+      throw new NotFoundException('Location not found');
+    }
+    return stats;
+  }
+
+  @Get(':id/aggregates')
+  async getAggregates(
+    @Param('id', ParseIntPipe) id: number,
+    @Query('granularity') granularity: AggregateGranularity,
+    @Query('from') from: string,
+    @Query('to') to: string,
+    @Request() req: AuthenticatedRequest,
+    @Query('cursor') cursor?: string,
+    @Query('limit') limit?: string,
+  ) {
+    const userId = req.user!.id;
+    const range = { from: new Date(from), to: new Date(to) };
+    if (isNaN(range.from.getTime()) || isNaN(range.to.getTime())) {
+      throw new BadRequestException('from and to are required');
+    }
+    if (!['1m', '5m', '1h', '6h', '1d'].includes(granularity)) {
+      throw new BadRequestException('Invalid granularity');
+    }
+    if (!(await this.locationsService.findById(id, userId))) {
+      throw new NotFoundException('Location not found');
+    }
+    return this.temperatureService.getLocationAggregatesPage(
+      id,
+      granularity,
+      range.from,
+      range.to,
+      cursor,
+      limit ? parseInt(limit, 10) : undefined,
+    );
+  }
+
   @Get(':id/device-count')
   async getDeviceCount(@Param('id', ParseIntPipe) id: number) {
     const count = await this.locationsService.getDeviceCount(id);
@@ -1,15 +1,18 @@
 import { Module } from '@nestjs/common';
 import { LocationsService } from './locations.service';
 import { LocationDevicesService } from './location-devices.service';
+import { LocationRollupService } from './location-rollup.service';
 import { LocationsController } from './locations.controller';
 import { LocationDevicesController } from './location-devices.controller';
 import { DbModule } from '../db/db.module';
 import { SupabaseModule } from '../auth/supabase.module';
+import { DevicesModule } from '../devices/devices.module';
+import { TemperatureModule } from '../temperature/temperature.module';
 
 @Module({
-  imports: [DbModule, SupabaseModule],
+  imports: [DbModule, SupabaseModule, DevicesModule, TemperatureModule],
   controllers: [LocationsController, LocationDevicesController],
-  providers: [LocationsService, LocationDevicesService],
-  exports: [LocationsService, LocationDevicesService],
+  providers: [LocationsService, LocationDevicesService, LocationRollupService],
+  exports: [LocationsService, LocationDevicesService, LocationRollupService],
 })
 export class LocationsModule {}
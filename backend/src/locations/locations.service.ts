@@ -1,7 +1,11 @@
 import { Injectable } from '@nestjs/common';
 import { eq, and, isNull, sql } from 'drizzle-orm';
 import { DbClient } from '../db/client';
-import { locations, devices } from '../db/schema';
+import { ClusterService } from '../cluster/cluster.service';
+import { locations, devices, locationClosure } from '../db/schema';
+import { DeviceSnapshotService } from '../devices/device-snapshot.service';
+import { LocationRollupService } from './location-rollup.service';
+import { attachSubtree, detachSubtree, insertLeaf } from './location-closure';
 
 export interface Location {
   id: number;
@@ -35,7 +39,25 @@ export interface LocationTreeNode extends Location {
 
 @Injectable()
 export class LocationsService {
-  constructor(private readonly dbClient: DbClient) {}
+  // Built trees per owner, dropped whenever one of their locations changes
+  private readonly trees = new Map<string, Promise<LocationTreeNode[]>>();
+  private readonly changed: (userId: string) => void;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    private readonly deviceSnapshotService: DeviceSnapshotService,
+    private readonly locationRollupService: LocationRollupService,
+    clusterService: ClusterService,
+  ) {
+    this.changed = clusterService.invalidation<string>(
+      'locations:owner',
+      (userId) => {
+        if (userId === null) this.trees.clear();
+        else this.trees.delete(userId);
+        this.locationRollupService.invalidate();
+      },
+    );
+  }
 
   async findAll(userId: string): Promise<Location[]> {
     const db = this.dbClient.db;
@@ -75,7 +97,19 @@ export class LocationsService {
     return result as Location[];
   }
 
-  async getTree(userId: string): Promise<LocationTreeNode[]> {
+  getTree(userId: string): Promise<LocationTreeNode[]> {
+    let tree = this.trees.get(userId);
+    if (!tree) {
+      tree = this.buildTree(userId);
+      this.trees.set(userId, tree);
+      tree.catch(() => {
+        if (this.trees.get(userId) === tree) this.trees.delete(userId);
+      });
+    }
+    return tree;
+  }
+
+  private async buildTree(userId: string): Promise<LocationTreeNode[]> {
     const allLocations = await this.findAll(userId);
 
     const locationMap = new Map<number, LocationTreeNode>();
@@ -108,17 +142,22 @@ export class LocationsService {
       }
     }
 
-    const result = await db
-      .insert(locations)
-      .values({
-        name: dto.name,
-        type: dto.type,
-        description: dto.description || null,
-        parentId: dto.parentId || null,
-        ownerId: dto.ownerId,
-      })
-      .returning();
+    const result = await db.transaction(async (tx) => {
+      const inserted = await tx
+        .insert(locations)
+        .values({
+          name: dto.name,
+          type: dto.type,
+          description: dto.description || null,
+          parentId: dto.parentId || null,
+          ownerId: dto.ownerId,
+        })
+        .returning();
+      await tx.execute(insertLeaf(inserted[0].id, inserted[0].parentId));
+      return inserted;
+    });
 
+    this.changed(dto.ownerId);
     return result[0] as Location;
   }
 
@@ -145,26 +184,40 @@ export class LocationsService {
         }
 
         if (
-          await this.wouldCreateCircularReference(
-            locationId,
-            dto.parentId,
-            userId,
-          )
+          await this.wouldCreateCircularReference(locationId, dto.parentId)
         ) {
           throw new Error('Cannot create circular reference');
         }
       }
     }
 
-    const result = await db
-      .update(locations)
-      .set({
-        ...dto,
-        updatedAt: new Date(),
-      })
-      .where(and(eq(locations.id, locationId), eq(locations.ownerId, userId)))
-      .returning();
+    const moved =
+      dto.parentId !== undefined &&
+      (dto.parentId ?? null) !== existing.parentId;
+
+    const result = await db.transaction(async (tx) => {
+      const updated = await tx
+        .update(locations)
+        .set({
+          ...dto,
+          updatedAt: new Date(),
+        })
+        .where(
+          and(eq(locations.id, locationId), eq(locations.ownerId, userId)),
+        )
+        .returning();
+
+      if (moved) {
+        await tx.execute(detachSubtree(locationId));
+        if (dto.parentId) {
+          await tx.execute(attachSubtree(locationId, dto.parentId));
+        }
+      }
+      return updated;
+    });
 
+    this.deviceSnapshotService.invalidate();
+    this.changed(userId);
     return result[0] as Location;
   }
 
@@ -188,6 +241,9 @@ export class LocationsService {
     await db
       .delete(locations)
       .where(and(eq(locations.id, locationId), eq(locations.ownerId, userId)));
+
+    this.deviceSnapshotService.invalidate();
+    this.changed(userId);
   }
 
   async getDeviceCount(locationId: number): Promise<number> {
@@ -201,26 +257,22 @@ export class LocationsService {
     return result[0]?.count || 0;
   }
 
+  // True when the new parent lies inside the location's own subtree
   private async wouldCreateCircularReference(
     locationId: number,
     newParentId: number,
-    userId: string,
   ): Promise<boolean> {
-    let currentId: number | null = newParentId;
-
-    while (currentId !== null) {
-      if (currentId === locationId) {
-        return true;
-      }
-
-      const current = await this.findById(currentId, userId);
-      if (!current) {
-        break;
-      }
-
-      currentId = current.parentId;
-    }
+    const result = await this.dbClient.db
+      .select({ depth: locationClosure.depth })
+      .from(locationClosure)
+      .where(
+        and(
+          eq(locationClosure.ancestorId, locationId),
+          eq(locationClosure.descendantId, newParentId),
+        ),
+      )
+      .limit(1);
 
-    return false;
+    return result.length > 0;
   }
 }
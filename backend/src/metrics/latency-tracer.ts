@@ -0,0 +1,111 @@
+import { Injectable } from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { MetricsService } from './metrics.service';
+
+// Epoch milliseconds at each hop of one reading. Device and browser values
+// come from their own clocks, so those hops include any clock skew.
+export interface TelemetryTrace {
+  deviceAt: number;
+  receivedAt: number;
+  committedAt?: number;
+  // First WebSocket emit; later clients get the same trace
+  emittedAt?: number;
+  // Only sampled traces are followed past the server to the browser
+  sampled: boolean;
+}
+
+// A sampled trace as emitted to one client, kept until it reports back
+export interface EmittedTrace {
+  deviceAt: number;
+  emittedAt: number;
+}
+
+// Sent by the browser for each sampled `telemetry:trace` it rendered
+export interface TraceReport {
+  traceId: number;
+  clientReceivedAt: number;
+  renderedAt: number;
+}
+
+export type LatencyHop =
+  | 'device_to_ingest'
+  | 'ingest_to_commit'
+  | 'commit_to_emit'
+  | 'emit_to_client'
+  | 'client_to_render'
+  | 'end_to_end';
+
+// Hops longer than this are bogus (wrong device clock, stale report)
+const MAX_HOP_MS = 24 * 60 * 60 * 1000;
+
+const clamp = (value: number, min: number, max: number) =>
+  Math.min(Math.max(value, min), max);
+
+/**
+ * Follows readings from the device timestamp through ingest, the database
+ * commit and WebSocket emit to the browser render, recording each hop in
+ * the `heatsync_telemetry_latency_seconds` histogram. Server hops are
+ * recorded for every reading; a TRACE_SAMPLE_RATE fraction is also sent
+ * to browsers, which report their receive and render times back.
+ */
+@Injectable()
+export class LatencyTracer {
+  private readonly sampleRate: number;
+
+  constructor(
+    configService: ConfigService,
+    private readonly metricsService: MetricsService,
+  ) {
+    this.sampleRate = Number(
+      configService.get<string>('TRACE_SAMPLE_RATE') ?? 0.01,
+    );
+  }
+
+  start(deviceAt: number, receivedAt: number): TelemetryTrace {
+    this.observe('device_to_ingest', deviceAt, receivedAt);
+    return { deviceAt, receivedAt, sampled: Math.random() < this.sampleRate };
+  }
+
+  committed(trace: TelemetryTrace, committedAt = Date.now()): void {
+    trace.committedAt = committedAt;
+    this.observe('ingest_to_commit', trace.receivedAt, committedAt);
+  }
+
+  // Recorded once per reading, however many clients it is emitted to
+  emitted(trace: TelemetryTrace, emittedAt: number): void {
+    if (trace.emittedAt !== undefined) return;
+    trace.emittedAt = emittedAt;
+    if (trace.committedAt !== undefined) {
+      this.observe('commit_to_emit', trace.committedAt, emittedAt);
+    }
+  }
+
+  // `trace` is the server's record of what it sent; only the browser's own
+  // receive and render times are taken from the report
+  report(
+    trace: EmittedTrace,
+    report: TraceReport,
+    reportedAt = Date.now(),
+  ): void {
+    const { clientReceivedAt, renderedAt } = report;
+    if (!Number.isFinite(clientReceivedAt) || !Number.isFinite(renderedAt)) {
+      return;
+    }
+    // Whatever the browser's clock says, the reading was received after it
+    // was emitted and rendered before the report arrived
+    const receivedAt = clamp(clientReceivedAt, trace.emittedAt, reportedAt);
+    const paintedAt = clamp(renderedAt, receivedAt, reportedAt);
+
+    this.observe('emit_to_client', trace.emittedAt, receivedAt);
+    this.observe('client_to_render', receivedAt, paintedAt);
+    this.observe('end_to_end', trace.deviceAt, paintedAt);
+  }
+
+  private observe(hop: LatencyHop, from: number, to: number) {
+    const elapsed = to - from;
+    if (!(elapsed >= 0 && elapsed <= MAX_HOP_MS)) return;
+    this.metricsService.telemetryLatencySeconds.observe(elapsed / 1000, {
+      hop,
+    });
+  }
+}
@@ -0,0 +1,29 @@
+import {
+  Controller,
+  Get,
+  Header,
+  Headers,
+  UnauthorizedException,
+} from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { MetricsService } from './metrics.service';
+
+@Controller('metrics')
+export class MetricsController {
+  constructor(
+    private readonly metricsService: MetricsService,
+    private readonly configService: ConfigService,
+  ) {}
+
+  // Scraped by Prometheus, so it skips user auth; METRICS_TOKEN, when set,
+  // must be sent as a bearer token
+  @Get()
+  @Header('Content-Type', 'text/plain; version=0.0.4; charset=utf-8')
+  getMetrics(@Headers('authorization') authorization?: string): string {
+    const token = this.configService.get<string>('METRICS_TOKEN');
+    if (token && authorization !== `Bearer ${token}`) {
+      throw new UnauthorizedException('Invalid metrics token');
+    }
+    return this.metricsService.render();
+  }
+}
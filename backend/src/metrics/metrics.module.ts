@@ -0,0 +1,13 @@
+import { Global, Module } from '@nestjs/common';
+import { MetricsService } from './metrics.service';
+import { MetricsController } from './metrics.controller';
+import { LatencyTracer } from './latency-tracer';
+
+// Global so any service can record metrics without importing this module
+@Global()
+@Module({
+  controllers: [MetricsController],
+  providers: [MetricsService, LatencyTracer],
+  exports: [MetricsService, LatencyTracer],
+})
+export class MetricsModule {}
@@ -0,0 +1,192 @@
+import { Injectable } from '@nestjs/common';
+import { monitorEventLoopDelay } from 'perf_hooks';
+import { AnyMetric, Counter, Gauge, Histogram } from './metrics';
+
+const EVENT_LOOP_RESOLUTION_MS = 10;
+
+/**
+ * Every metric the backend exports, in one place so names and labels stay
+ * consistent. Services record into these fields directly.
+ */
+@Injectable()
+export class MetricsService {
+  private readonly metrics: AnyMetric[] = [];
+
+  // MQTT ingest
+  readonly ingestMessages = this.register(
+    new Counter(
+      'heatsync_ingest_messages_total',
+      'Telemetry messages by ingest outcome',
+    ),
+  );
+  readonly ingestRejected = this.register(
+    new Counter(
+      'heatsync_ingest_rejected_total',
+      'Telemetry payloads that failed validation, by device and reason',
+    ),
+  );
+  readonly ingestStageSeconds = this.register(
+    new Histogram(
+      'heatsync_ingest_stage_seconds',
+      'Time spent in each ingest pipeline stage',
+    ),
+  );
+  readonly ingestQueueDepth = this.register(
+    new Gauge(
+      'heatsync_ingest_queue_depth',
+      'Messages waiting to be processed',
+    ),
+  );
+  readonly ingestInFlight = this.register(
+    new Gauge(
+      'heatsync_ingest_in_flight',
+      'Messages currently being processed',
+    ),
+  );
+
+  readonly telemetryLatencySeconds = this.register(
+    new Histogram(
+      'heatsync_telemetry_latency_seconds',
+      'Latency of each hop from device sample to browser render',
+    ),
+  );
+
+  // Postgres
+  readonly dbQuerySeconds = this.register(
+    new Histogram(
+      'heatsync_db_query_seconds',
+      'Duration of pooled queries, including the wait for a connection',
+    ),
+  );
+  readonly dbAcquireSeconds = this.register(
+    new Histogram(
+      'heatsync_db_acquire_seconds',
+      'Wait for a dedicated pool connection',
+    ),
+  );
+  readonly dbPoolConnections = this.register(
+    new Gauge(
+      'heatsync_db_pool_connections',
+      'Pool connections by state; waiting counts queued requests',
+    ),
+  );
+
+  // WebSocket fan-out
+  readonly wsClients = this.register(
+    new Gauge('heatsync_ws_clients', 'Connected WebSocket clients'),
+  );
+  readonly wsFrames = this.register(
+    new Counter('heatsync_ws_frames_total', 'Telemetry frames emitted'),
+  );
+  readonly wsFrameUpdates = this.register(
+    new Counter(
+      'heatsync_ws_frame_updates_total',
+      'Device updates carried by emitted telemetry frames',
+    ),
+  );
+  readonly wsFlushSeconds = this.register(
+    new Histogram(
+      'heatsync_ws_flush_seconds',
+      'Time to build and emit one round of telemetry frames',
+    ),
+  );
+
+  // Alerts
+  readonly alertEvaluations = this.register(
+    new Counter(
+      'heatsync_alert_evaluations_total',
+      'Alert rules evaluated against incoming readings',
+    ),
+  );
+  readonly alertsTriggered = this.register(
+    new Counter('heatsync_alerts_triggered_total', 'Alerts that fired'),
+  );
+  readonly alertNotifications = this.register(
+    new Counter(
+      'heatsync_alert_notifications_total',
+      'Alert notification deliveries by result',
+    ),
+  );
+
+  // Auth
+  readonly authVerifications = this.register(
+    new Counter(
+      'heatsync_auth_verifications_total',
+      'Access token checks by result: local, cached, remote or rejected',
+    ),
+  );
+
+  // Cluster
+  readonly clusterMessages = this.register(
+    new Counter(
+      'heatsync_cluster_messages_total',
+      'Cluster bus messages: sent, received, oversized or send_failed',
+    ),
+  );
+
+  // Aggregation jobs
+  readonly aggregationSeconds = this.register(
+    new Histogram(
+      'heatsync_aggregation_seconds',
+      'Duration of aggregation runs per granularity',
+    ),
+  );
+
+  // Process
+  readonly processCpuSeconds = this.register(
+    new Counter('process_cpu_seconds_total', 'User and system CPU time'),
+  );
+  readonly processResidentMemory = this.register(
+    new Gauge('process_resident_memory_bytes', 'Resident memory size'),
+  );
+  readonly heapUsed = this.register(
+    new Gauge('nodejs_heap_used_bytes', 'V8 heap in use'),
+  );
+  readonly eventLoopLag = this.register(
+    new Gauge(
+      'nodejs_eventloop_lag_seconds',
+      'Event loop delay since the previous scrape, by quantile',
+    ),
+  );
+
+  private readonly eventLoopDelay = monitorEventLoopDelay({
+    resolution: EVENT_LOOP_RESOLUTION_MS,
+  });
+
+  constructor() {
+    this.processCpuSeconds.collect(() => {
+      const { user, system } = process.cpuUsage();
+      this.processCpuSeconds.set({}, (user + system) / 1e6);
+    });
+    this.processResidentMemory.collect(() =>
+      this.processResidentMemory.set(process.memoryUsage.rss()),
+    );
+    this.heapUsed.collect(() =>
+      this.heapUsed.set(process.memoryUsage().heapUsed),
+    );
+
+    this.eventLoopDelay.enable();
+    this.eventLoopLag.collect(() => {
+      const delay = this.eventLoopDelay;
+      // Samples are the time between timer ticks, in nanoseconds, so the
+      // tick interval itself is not lag
+      const lag = (ns: number) =>
+        delay.count > 0
+          ? Math.max(0, ns / 1e9 - EVENT_LOOP_RESOLUTION_MS / 1000)
+          : 0;
+      this.eventLoopLag.set(lag(delay.percentile(50)), { quantile: '0.5' });
+      this.eventLoopLag.set(lag(delay.percentile(99)), { quantile: '0.99' });
+      this.eventLoopLag.set(lag(delay.max), { quantile: '1' });
+      delay.reset();
+    });
+  }
+
+  render(): string {
+    return this.metrics.map((metric) => metric.render()).join('\n') + '\n';
+  }
+
+  private register<T extends AnyMetric>(metric: T): T {
+    this.metrics.push(metric);
+    return metric;
+  }
+}
@@ -0,0 +1,32 @@
+import { Counter, Histogram } from './metrics';
+
+describe('metrics', () => {
+  it('renders labelled counters', () => {
+    const counter = new Counter('requests_total', 'Requests');
+    counter.inc({ route: '/a' });
+    counter.inc({ route: '/a' }, 2);
+    counter.inc({ route: 'say "hi"' });
+
+    expect(counter.render().split('\n')).toEqual([
+      '# HELP requests_total Requests',
+      '# TYPE requests_total counter',
+      'requests_total{route="/a"} 3',
+      'requests_total{route="say \\"hi\\""} 1',
+    ]);
+  });
+
+  it('renders cumulative histogram buckets', () => {
+    const histogram = new Histogram('latency_seconds', 'Latency', [0.1, 1]);
+    histogram.observe(0.05);
+    histogram.observe(0.5);
+    histogram.observe(5);
+
+    expect(histogram.render().split('\n').slice(2)).toEqual([
+      'latency_seconds_bucket{le="0.1"} 1',
+      'latency_seconds_bucket{le="1"} 2',
+      'latency_seconds_bucket{le="+Inf"} 3',
+      'latency_seconds_sum 5.55',
+      'latency_seconds_count 3',
+    ]);
+  });
+});
@@ -0,0 +1,173 @@
+export type Labels = Record<string, string>;
+
+// Seconds; covers sub-millisecond stages up to slow aggregation runs
+export const DEFAULT_BUCKETS = [
+  0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5,
+  10, 30,
+];
+
+/**
+ * Minimal Prometheus client: metrics keep one series per label set and
+ * render themselves in the text exposition format. A metric may register
+ * a collector that refreshes its values right before each scrape, for
+ * numbers that are owned and counted elsewhere.
+ */
+abstract class Metric<S> {
+  protected readonly series = new Map<string, { labels: Labels; value: S }>();
+  private collector: (() => void) | null = null;
+
+  constructor(
+    readonly name: string,
+    readonly help: string,
+    private readonly type: 'counter' | 'gauge' | 'histogram',
+  ) {}
+
+  collect(collector: () => void): this {
+    this.collector = collector;
+    return this;
+  }
+
+  render(): string {
+    this.collector?.();
+    const lines = [
+      `# HELP ${this.name} ${this.help}`,
+      `# TYPE ${this.name} ${this.type}`,
+    ];
+    for (const { labels, value } of this.series.values()) {
+      lines.push(...this.renderSeries(labels, value));
+    }
+    return lines.join('\n');
+  }
+
+  protected abstract initial(): S;
+
+  protected abstract renderSeries(labels: Labels, value: S): string[];
+
+  protected get(labels: Labels): S {
+    const key = JSON.stringify(labels);
+    let entry = this.series.get(key);
+    if (!entry) {
+      entry = { labels, value: this.initial() };
+      this.series.set(key, entry);
+    }
+    return entry.value;
+  }
+}
+
+export class Counter extends Metric<{ value: number }> {
+  constructor(name: string, help: string) {
+    super(name, help, 'counter');
+  }
+
+  inc(labels: Labels = {}, by = 1): void {
+    this.get(labels).value += by;
+  }
+
+  // For mirroring a cumulative total that is counted elsewhere
+  set(labels: Labels, value: number): void {
+    this.get(labels).value = value;
+  }
+
+  protected initial() {
+    return { value: 0 };
+  }
+
+  protected renderSeries(labels: Labels, { value }: { value: number }) {
+    return [`${this.name}${formatLabels(labels)} ${value}`];
+  }
+}
+
+export class Gauge extends Metric<{ value: number }> {
+  constructor(name: string, help: string) {
+    super(name, help, 'gauge');
+  }
+
+  set(value: number, labels: Labels = {}): void {
+    this.get(labels).value = value;
+  }
+
+  inc(labels: Labels = {}, by = 1): void {
+    this.get(labels).value += by;
+  }
+
+  dec(labels: Labels = {}, by = 1): void {
+    this.get(labels).value -= by;
+  }
+
+  protected initial() {
+    return { value: 0 };
+  }
+
+  protected renderSeries(labels: Labels, { value }: { value: number }) {
+    return [`${this.name}${formatLabels(labels)} ${value}`];
+  }
+}
+
+interface HistogramSeries {
+  counts: number[];
+  sum: number;
+  count: number;
+}
+
+export class Histogram extends Metric<HistogramSeries> {
+  constructor(
+    name: string,
+    help: string,
+    private readonly buckets = DEFAULT_BUCKETS,
+  ) {
+    super(name, help, 'histogram');
+  }
+
+  observe(seconds: number, labels: Labels = {}): void {
+    const series = this.get(labels);
+    const index = this.buckets.findIndex((bound) => seconds <= bound);
+    if (index !== -1) series.counts[index]++;
+    series.sum += seconds;
+    series.count++;
+  }
+
+  // Returns a function that observes the time elapsed since this call
+  startTimer(labels: Labels = {}): () => void {
+    const start = process.hrtime.bigint();
+    return () =>
+      this.observe(Number(process.hrtime.bigint() - start) / 1e9, labels);
+  }
+
+  protected initial(): HistogramSeries {
+    return { counts: this.buckets.map(() => 0), sum: 0, count: 0 };
+  }
+
+  protected renderSeries(labels: Labels, series: HistogramSeries) {
+    let cumulative = 0;
+    const lines = this.buckets.map((bound, i) => {
+      cumulative += series.counts[i];
+      const le = formatLabels({ ...labels, le: String(bound) });
+      return `${this.name}_bucket${le} ${cumulative}`;
+    });
+    const inf = formatLabels({ ...labels, le: '+Inf' });
+    lines.push(
+      `${this.name}_bucket${inf} ${series.count}`,
+      `${this.name}_sum${formatLabels(labels)} ${series.sum}`,
+      `${this.name}_count${formatLabels(labels)} ${series.count}`,
+    );
+    return lines;
+  }
+}
+
+export type AnyMetric = Counter | Gauge | Histogram;
+
+function formatLabels(labels: Labels): string {
+  const entries = Object.entries(labels);
+  if (entries.length === 0) return '';
+  const pairs = entries.map(
+    ([key, value]) => `${key}="${escapeLabelValue(value)}"`,
+  );
+  return `{${pairs.join(',')}}`;
+}
+
+function escapeLabelValue(value: string): string {
+  return value
+    .replace(/\\/g, '\\\\')
+    .replace(/"/g, '\\"')
+    .replace(/\n/g, '\\n');
+}
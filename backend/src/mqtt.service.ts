@@ -1,32 +1,183 @@
-import { Injectable, OnModuleInit } from '@nestjs/common';
+import {
+  Injectable,
+  Logger,
+  OnModuleDestroy,
+  OnModuleInit,
+} from '@nestjs/common';
 import { ConfigService } from '@nestjs/config';
+import { randomUUID } from 'crypto';
 import * as mqtt from 'mqtt';
+import { availableParallelism } from 'os';
+import { performance } from 'perf_hooks';
 import { TemperatureService } from './temperature/temperature.service';
 import { DevicesService } from './devices/devices.service';
+import { DeviceSnapshotService } from './devices/device-snapshot.service';
+import { LocationRollupService } from './locations/location-rollup.service';
 import { WebsocketGateway } from './websocket/websocket.gateway';
+import { IngestQueue } from './ingest/ingest-queue';
+import { IngestStats } from './ingest/ingest-stats';
+import { IngestWal, WalEntry } from './ingest/ingest-wal';
+import { TelemetryRejected } from './ingest/telemetry-batch';
+import { TelemetryDecodePool } from './ingest/telemetry-decode-pool';
+import { MetricsService } from './metrics/metrics.service';
+import { LatencyTracer, TelemetryTrace } from './metrics/latency-tracer';
+import { ClusterService } from './cluster/cluster.service';
+import {
+  TELEMETRY_TOPIC,
+  TemperatureMessage,
+} from './ingest/telemetry.generated';
 
-interface TemperatureMessage {
-  temperature: number;
-  humidity?: number;
+interface IngestJob {
+  data: TemperatureMessage;
+  receivedAt: number;
+  // Wall-clock receive time, stored as the reading's takenAt
+  arrivedAt: number;
+  // The message's WAL record, null if it could not be spooled
+  wal: WalEntry | null;
+  // Id of that record, stored with the reading; null for records that
+  // predate record ids
+  ingestId: string | null;
+  trace: TelemetryTrace;
+  // Read back from the WAL at startup rather than received live
+  replayed: boolean;
+  // Failed attempts to persist it
+  failures: number;
+}
+
+// A processed reading, applied to live state on every dashboard instance
+interface ProcessedReading {
   deviceId: string;
-  timestamp: number;
+  temperature: number;
+  humidity: number | null;
+  // Set when the reading was stored rather than skipped as unchanged
+  takenAt: number | null;
+  seenAt: number;
+  trace: TelemetryTrace;
 }
 
+// Payloads sent to a decode worker at once; smaller batches are decoded
+// on the main thread, where they cost less than the round trip
+const DECODE_MIN_BATCH = 8;
+const DECODE_MAX_BATCH = 256;
+
+// A reading that fails to persist is retried after 1, 2, 4 and 8 seconds,
+// then left in the WAL for the next start
+const PERSIST_RETRY_MS = 1000;
+const MAX_PERSIST_ATTEMPTS = 5;
+
+// Devices tracked individually in the rejection metric; the rest are 'other'
+const MAX_REJECTING_DEVICES = 500;
+
 import { AlertsService } from './alerts/alerts.service';
 
 @Injectable()
-export class MqttService implements OnModuleInit {
+export class MqttService implements OnModuleInit, OnModuleDestroy {
   private client: mqtt.MqttClient;
+  private queue: IngestQueue<IngestJob>;
+  private wal: IngestWal;
+  private decodePool: TelemetryDecodePool;
+  private readonly stats: IngestStats;
+  private readonly lastTimestamps = new Map<string, number>();
+  private readonly rejectingDevices = new Set<string>();
+  private readonly logger = new Logger('MqttService');
+  private statsTimer: NodeJS.Timeout | null = null;
+  private readonly retryTimers = new Set<NodeJS.Timeout>();
+  // 'pause' stops reading from the broker when full, 'shed' drops messages
+  private overflow: 'pause' | 'shed';
+  private resumeDepth: number;
+  // Messages read from the broker and not yet admitted to the queue
+  private readAhead = 0;
+  private readAheadLimit: number;
+  private heldPacket: (() => void) | null = null;
 
   constructor(
     private readonly configService: ConfigService,
     private readonly temperatureService: TemperatureService,
     private readonly devicesService: DevicesService,
+    private readonly deviceSnapshotService: DeviceSnapshotService,
+    private readonly locationRollupService: LocationRollupService,
     private readonly websocketGateway: WebsocketGateway,
     private readonly alertsService: AlertsService,
-  ) {}
+    private readonly metricsService: MetricsService,
+    private readonly latencyTracer: LatencyTracer,
+    private readonly clusterService: ClusterService,
+  ) {
+    this.stats = new IngestStats((stage, ms) =>
+      this.metricsService.ingestStageSeconds.observe(ms / 1000, { stage }),
+    );
+  }
+
+  async onModuleInit(): Promise<void> {
+    if (this.clusterService.hasRole('dashboard')) {
+      this.clusterService.subscribe<ProcessedReading>(
+        'telemetry',
+        (reading) => {
+          this.deviceSnapshotService.recordSeen(
+            reading.deviceId,
+            new Date(reading.seenAt),
+          );
+          this.fanOut(reading);
+        },
+      );
+    }
+
+    // Dashboard-only instances leave MQTT to the ingest tier
+    if (!this.clusterService.hasRole('ingest')) return;
+
+    const capacity = Number(
+      this.configService.get<string>('INGEST_QUEUE_CAPACITY') ?? 10_000,
+    );
+    this.queue = new IngestQueue<IngestJob>(
+      {
+        capacity,
+        concurrency: Number(
+          this.configService.get<string>('INGEST_CONCURRENCY') ?? 8,
+        ),
+      },
+      (job) => job.data.deviceId,
+      async (job) => {
+        const persisted = await this.process(job);
+        if (!persisted && ++job.failures < MAX_PERSIST_ATTEMPTS) {
+          this.retryLater(job);
+          return;
+        }
+        if (job.wal) this.wal.complete(job.wal, persisted);
+      },
+    );
+    this.overflow =
+      this.configService.get<string>('INGEST_OVERFLOW') === 'shed'
+        ? 'shed'
+        : 'pause';
+    this.resumeDepth = Math.floor(capacity / 2);
+    this.readAheadLimit = Number(
+      this.configService.get<string>('INGEST_READ_AHEAD') ?? 512,
+    );
+
+    this.decodePool = new TelemetryDecodePool({
+      workers: Number(
+        this.configService.get<string>('INGEST_DECODE_WORKERS') ??
+          Math.min(2, availableParallelism() - 1),
+      ),
+      minBatch: DECODE_MIN_BATCH,
+      maxBatch: DECODE_MAX_BATCH,
+    });
+
+    this.wal = new IngestWal({
+      dir: this.configService.get<string>('INGEST_WAL_DIR') ?? 'ingest-wal',
+      segmentBytes: Number(
+        this.configService.get<string>('INGEST_WAL_SEGMENT_BYTES') ??
+          8 * 1024 * 1024,
+      ),
+      segmentMaxAgeMs: 60_000,
+      flushIntervalMs: Number(
+        this.configService.get<string>('INGEST_WAL_FLUSH_MS') ?? 5,
+      ),
+    });
+    await this.replay();
+
+    this.statsTimer = setInterval(() => this.logStats(), 60_000);
+    this.registerMetrics();
 
-  onModuleInit(): void {
     this.client = mqtt.connect({
       host: this.configService.get<string>('MQTT_HOST'),
       port: this.configService.get<number>('MQTT_PORT'),
@@ -37,10 +188,22 @@ export class MqttService implements OnModuleInit {
       password: this.configService.get<string>('MQTT_PASSWORD'),
     });
 
+    // In cluster mode the broker hands each message to one member of the
+    // shared subscription group, partitioning ingest across instances
+    const group =
+      this.configService.get<string>('MQTT_SHARE_GROUP') ?? 'heatsync-ingest';
+    const filter = this.clusterService.enabled
+      ? `$share/${group}/${TELEMETRY_TOPIC}`
+      : TELEMETRY_TOPIC;
+
+    // At QoS 1 the broker redelivers messages not yet in the WAL when the
+    // connection drops, at the cost of decoding them one at a time
+    const qos = this.configService.get<string>('MQTT_QOS') === '1' ? 1 : 0;
+
     this.client.on('connect', () => {
-      this.client.subscribe('heatsync/telemetry', (err) => {
+      this.client.subscribe(filter, { qos }, (err) => {
         if (!err) {
-          console.log('Subscribed to heatsync/telemetry');
+          console.log(`Subscribed to ${filter}`);
         } else {
           console.error('Failed to subscribe:', err.message);
         }
@@ -51,37 +214,349 @@ export class MqttService implements OnModuleInit {
       console.error('MQTT connection error:', error);
     });
 
-    this.client.on('message', (topic: string, payload: Buffer) => {
-      if (topic === 'heatsync/telemetry') {
-        const data = JSON.parse(payload.toString()) as TemperatureMessage;
-
-        void (async () => {
-          try {
-            await this.temperatureService.saveIfChanged(
-              data.temperature,
-              data.deviceId,
-              data.timestamp,
-              data.humidity,
-            );
-
-            await this.devicesService.updateLastSeen(data.deviceId);
-
-            this.websocketGateway.broadcastTemperatureUpdate(
-              data.deviceId,
-              data.temperature,
-              data.humidity,
-            );
-
-            await this.alertsService.checkAlerts(
-              data.deviceId,
-              data.temperature,
-              data.humidity,
-            );
-          } catch (error) {
-            console.error('Error processing temperature message:', error);
-          }
-        })();
+    // MQTT.js does not read the next packet until `done` is called, which
+    // is how a full queue pushes back on the broker connection
+    this.client.handleMessage = (packet, done) => {
+      this.receive(packet.topic, packet.payload as Buffer, packet.qos, () =>
+        done(),
+      );
+    };
+  }
+
+  async onModuleDestroy(): Promise<void> {
+    if (this.statsTimer) clearInterval(this.statsTimer);
+    // Their records stay in the WAL and are replayed on the next start
+    this.retryTimers.forEach((timer) => clearTimeout(timer));
+    this.client?.end();
+    await this.decodePool?.close();
+    await this.wal?.close();
+  }
+
+  getStats() {
+    return {
+      queueDepth: this.queue.depth,
+      inFlight: this.queue.inFlight,
+      ...this.stats.snapshot(),
+    };
+  }
+
+  // Messages left in the WAL by a previous run are processed before any
+  // new traffic is read from the broker
+  private async replay() {
+    const replays = await this.wal.open();
+    for (const { segment, records } of replays) {
+      this.logger.log(
+        `Replaying ${records.length} messages from WAL segment ${segment}`,
+      );
+      const results = await Promise.all(
+        records.map((record) =>
+          // The id only goes into a new WAL line, which replays do not need
+          this.decodePool.decode(
+            Buffer.from(record.payload),
+            record.receivedAt,
+            '',
+          ),
+        ),
+      );
+      for (const [index, record] of records.entries()) {
+        const result = results[index];
+        if (!result.ok) {
+          this.reject(result);
+          this.wal.complete(record.entry, true);
+          continue;
+        }
+        const data = result.message;
+        this.stats.replayed++;
+        await new Promise<void>((resolve) =>
+          this.admit(
+            {
+              data,
+              receivedAt: performance.now(),
+              arrivedAt: record.receivedAt,
+              wal: record.entry,
+              ingestId: record.id ?? null,
+              replayed: true,
+              failures: 0,
+              // Its hops were recorded when it first arrived
+              trace: {
+                deviceAt: data.timestamp,
+                receivedAt: record.receivedAt,
+                sampled: false,
+              },
+            },
+            resolve,
+          ),
+        );
+      }
+    }
+  }
+
+  private receive(
+    topic: string,
+    payload: Buffer,
+    qos: number,
+    done: () => void,
+  ) {
+    // Shared subscriptions still deliver the original topic
+    if (topic !== TELEMETRY_TOPIC) {
+      done();
+      return;
+    }
+
+    this.stats.received++;
+    const receivedAt = performance.now();
+    const arrivedAt = Date.now();
+
+    // Reading ahead lets a burst fill a decode batch; past the limit the
+    // broker connection waits until earlier messages are admitted. `done`
+    // acknowledges a QoS 1 or 2 message, so for those it waits until the
+    // message is in the WAL, and nothing else is read meanwhile
+    this.readAhead++;
+    let release = () => this.release();
+    if (qos > 0) {
+      release = () => {
+        this.release();
+        done();
+      };
+    } else if (this.readAhead < this.readAheadLimit) {
+      done();
+    } else {
+      this.heldPacket = done;
+    }
+
+    const ingestId = randomUUID();
+    void this.decodePool.decode(payload, arrivedAt, ingestId).then((result) => {
+      // Invalid payloads are dropped before they reach the WAL
+      if (!result.ok) {
+        this.reject(result);
+        release();
+        return;
+      }
+      const data = result.message;
+      this.stats.record('parse', receivedAt);
+      const trace = this.latencyTracer.start(data.timestamp, arrivedAt);
+      const job = (wal: WalEntry | null): IngestJob => ({
+        data,
+        receivedAt,
+        arrivedAt,
+        wal,
+        ingestId,
+        trace,
+        replayed: false,
+        failures: 0,
+      });
+
+      // The message is only handed on once it is on disk
+      this.wal.appendLine(result.walLine).then(
+        (wal) => {
+          this.stats.record('spool', receivedAt);
+          this.admit(job(wal), release);
+        },
+        (error) => {
+          console.error('Failed to spool telemetry message:', error);
+          this.admit(job(null), release);
+        },
+      );
+    });
+  }
+
+  // Called once a message read from the broker is admitted or dropped
+  private release() {
+    this.readAhead--;
+    const held = this.heldPacket;
+    if (held && this.readAhead < this.readAheadLimit) {
+      this.heldPacket = null;
+      held();
+    }
+  }
+
+  // Counted per sender, so a misbehaving device stands out
+  private reject({ reason, field, deviceId }: TelemetryRejected) {
+    this.stats.parseFailures++;
+
+    let device = deviceId ?? 'unknown';
+    if (deviceId !== null && !this.rejectingDevices.has(deviceId)) {
+      if (this.rejectingDevices.size < MAX_REJECTING_DEVICES) {
+        this.rejectingDevices.add(deviceId);
+        this.logger.warn(
+          `Rejecting telemetry from ${deviceId}: ${reason}${field ? ` (${field})` : ''}`,
+        );
+      } else {
+        device = 'other';
       }
+    }
+    this.metricsService.ingestRejected.inc({
+      device,
+      reason,
+      field: field ?? '',
     });
   }
+
+  private admit(job: IngestJob, done: () => void) {
+    if (!this.queue.offer(job)) {
+      if (this.overflow === 'shed') {
+        this.stats.shed++;
+        // Spooled but never persisted, so it is retried on next start
+        if (job.wal) this.wal.complete(job.wal, false);
+        done();
+        return;
+      }
+      this.stats.pauses++;
+      // Replays, retries and other waiters may refill the queue first
+      void this.queue
+        .waitForDepth(this.resumeDepth)
+        .then(() => this.admit(job, done));
+      return;
+    }
+
+    if (this.overflow === 'pause' && this.queue.isFull) {
+      this.stats.pauses++;
+      void this.queue.waitForDepth(this.resumeDepth).then(done);
+      return;
+    }
+
+    done();
+  }
+
+  private retryLater(job: IngestJob) {
+    const timer = setTimeout(
+      () => {
+        this.retryTimers.delete(timer);
+        this.admit(job, () => undefined);
+      },
+      PERSIST_RETRY_MS * 2 ** (job.failures - 1),
+    );
+    this.retryTimers.add(timer);
+  }
+
+  // Resolves to false when the reading did not reach Postgres
+  private async process({
+    data,
+    arrivedAt,
+    ingestId,
+    trace,
+    replayed,
+    failures,
+  }: IngestJob): Promise<boolean> {
+    let persisted = false;
+    try {
+      let stageStart = performance.now();
+
+      // Devices may republish the same sample after reconnecting
+      if (this.lastTimestamps.get(data.deviceId) === data.timestamp) {
+        this.stats.duplicates++;
+        return true;
+      }
+      stageStart = this.stats.record('dedupe', stageStart);
+
+      const saved = await this.temperatureService.saveIfChanged(
+        data.temperature,
+        data.deviceId,
+        data.timestamp,
+        data.humidity,
+        new Date(arrivedAt),
+        ingestId,
+      );
+
+      await this.devicesService.updateLastSeen(data.deviceId);
+      persisted = true;
+      // Only once stored, so a failed attempt is not taken for a duplicate
+      // when it is retried
+      this.lastTimestamps.set(data.deviceId, data.timestamp);
+      stageStart = this.stats.record('persist', stageStart);
+
+      // Newer readings may have been broadcast and alerted on already
+      if (replayed || failures > 0) {
+        this.stats.processed++;
+        return true;
+      }
+      this.latencyTracer.committed(trace);
+
+      const reading: ProcessedReading = {
+        deviceId: data.deviceId,
+        temperature: data.temperature,
+        humidity: data.humidity ?? null,
+        takenAt: saved ? saved.takenAt.getTime() : null,
+        seenAt: Date.now(),
+        trace,
+      };
+      this.fanOut(reading);
+      this.clusterService.publish('telemetry', reading);
+      stageStart = this.stats.record('fanout', stageStart);
+
+      await this.alertsService.checkAlerts(
+        data.deviceId,
+        data.temperature,
+        data.humidity,
+      );
+      this.stats.record('alert', stageStart);
+
+      this.stats.processed++;
+    } catch (error) {
+      this.stats.failed++;
+      console.error('Error processing temperature message:', error);
+    }
+    return persisted;
+  }
+
+  // Patches live state and queues the WebSocket update on this instance
+  private fanOut(reading: ProcessedReading) {
+    const { deviceId, temperature, humidity, takenAt } = reading;
+    if (takenAt !== null) {
+      const at = new Date(takenAt);
+      this.deviceSnapshotService.recordReading(
+        deviceId,
+        temperature,
+        humidity,
+        at,
+      );
+      this.locationRollupService.recordReading(
+        deviceId,
+        temperature,
+        humidity,
+        at,
+      );
+    }
+
+    this.websocketGateway.broadcastTemperatureUpdate(
+      deviceId,
+      temperature,
+      humidity ?? undefined,
+      reading.trace,
+    );
+  }
+
+  private registerMetrics() {
+    const { ingestMessages, ingestQueueDepth, ingestInFlight } =
+      this.metricsService;
+
+    ingestMessages.collect(() => {
+      const outcomes = {
+        received: this.stats.received,
+        replayed: this.stats.replayed,
+        processed: this.stats.processed,
+        parse_failure: this.stats.parseFailures,
+        duplicate: this.stats.duplicates,
+        shed: this.stats.shed,
+        failed: this.stats.failed,
+      };
+      for (const [outcome, total] of Object.entries(outcomes)) {
+        ingestMessages.set({ outcome }, total);
+      }
+    });
+    ingestQueueDepth.collect(() => ingestQueueDepth.set(this.queue.depth));
+    ingestInFlight.collect(() => ingestInFlight.set(this.queue.inFlight));
+  }
+
+  private logStats() {
+    const stats = this.getStats();
+    if (stats.received === 0) return;
+
+    const stages = Object.entries(stats.stages)
+      .map(([stage, s]) => `${stage}=${s.avgMs.toFixed(1)}ms`)
+      .join(' ');
+    this.logger.log(
+      `Ingest: depth=${stats.queueDepth} inFlight=${stats.inFlight} processed=${stats.processed} failed=${stats.failed} shed=${stats.shed} ${stages}`,
+    );
+  }
 }
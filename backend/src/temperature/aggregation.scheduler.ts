@@ -1,18 +1,27 @@
 import { Injectable } from '@nestjs/common';
 import { Cron, CronExpression } from '@nestjs/schedule';
-import { TemperatureService } from './temperature.service';
+import { DbClient } from '../db/client';
+import { MetricsService } from '../metrics/metrics.service';
+import {
+  AggregateGranularity,
+  TemperatureService,
+} from './temperature.service';
 
 @Injectable()
 export class AggregationScheduler {
-  constructor(private readonly temperatureService: TemperatureService) {}
+  constructor(
+    private readonly temperatureService: TemperatureService,
+    private readonly metricsService: MetricsService,
+    private readonly dbClient: DbClient,
+  ) {}
 
   // Every minute: aggregate the last 15 minutes into 1-minute buckets
   @Cron(CronExpression.EVERY_MINUTE)
   async aggregateRecentMinutes() {
     const to = new Date();
     const from = new Date(to.getTime() - 15 * 60 * 1000);
-    await this.temperatureService.aggregateAndStore('1m', from, to);
-    await this.temperatureService.aggregateAndStore('5m', from, to);
+    await this.aggregate('1m', from, to);
+    await this.aggregate('5m', from, to);
   }
 
   // Every hour: aggregate the last 6 hours into 1h and 6h buckets
@@ -20,8 +29,8 @@ export class AggregationScheduler {
   async aggregateRecentHours() {
     const to = new Date();
     const from = new Date(to.getTime() - 6 * 60 * 60 * 1000);
-    await this.temperatureService.aggregateAndStore('1h', from, to);
-    await this.temperatureService.aggregateAndStore('6h', from, to);
+    await this.aggregate('1h', from, to);
+    await this.aggregate('6h', from, to);
   }
 
   // Daily: aggregate the last 2 days into daily buckets
@@ -29,6 +38,29 @@ export class AggregationScheduler {
   async aggregateDaily() {
     const to = new Date();
     const from = new Date(to.getTime() - 2 * 24 * 60 * 60 * 1000);
-    await this.temperatureService.aggregateAndStore('1d', from, to);
+    await this.aggregate('1d', from, to);
+  }
+
+  private async aggregate(
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+  ) {
+    // With several instances, whichever takes the lock first does the run
+    await this.dbClient.withTryLock(`aggregate:${granularity}`, async () => {
+      const done = this.metricsService.aggregationSeconds.startTimer({
+        granularity,
+      });
+      try {
+        await this.temperatureService.aggregateAndStore(granularity, from, to);
+        await this.temperatureService.aggregateLocationsAndStore(
+          granularity,
+          from,
+          to,
+        );
+      } finally {
+        done();
+      }
+    });
   }
 }
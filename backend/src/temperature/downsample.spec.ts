@@ -0,0 +1,37 @@
+import { lttb } from './downsample';
+
+describe('lttb', () => {
+  const x = (p: [number, number]) => p[0];
+  const y = (p: [number, number]) => p[1];
+
+  it('returns the input when it is already below the threshold', () => {
+    const data: [number, number][] = [
+      [0, 1],
+      [1, 2],
+      [2, 3],
+    ];
+    expect(lttb(data, 10, x, y)).toBe(data);
+  });
+
+  it('keeps the endpoints and reduces to the threshold', () => {
+    const data: [number, number][] = Array.from({ length: 1000 }, (_, i) => [
+      i,
+      Math.sin(i / 20),
+    ]);
+    const sampled = lttb(data, 100, x, y);
+
+    expect(sampled).toHaveLength(100);
+    expect(sampled[0]).toBe(data[0]);
+    expect(sampled[99]).toBe(data[999]);
+  });
+
+  it('preserves a single spike', () => {
+    const data: [number, number][] = Array.from({ length: 500 }, (_, i) => [
+      i,
+      i === 250 ? 100 : 20,
+    ]);
+    const sampled = lttb(data, 20, x, y);
+
+    expect(sampled.some((p) => p[1] === 100)).toBe(true);
+  });
+});
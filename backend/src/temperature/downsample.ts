@@ -0,0 +1,63 @@
+/**
+ * Largest-Triangle-Three-Buckets downsampling.
+ *
+ * Keeps the first and last points and, for every bucket in between, the point
+ * forming the largest triangle with the previously kept point and the average
+ * of the next bucket. Peaks and troughs survive, so the reduced series keeps
+ * the visual shape of the original. `data` must be sorted by `x` ascending.
+ */
+export function lttb<T>(
+  data: T[],
+  threshold: number,
+  x: (point: T) => number,
+  y: (point: T) => number,
+): T[] {
+  if (threshold >= data.length || threshold < 3) {
+    return data;
+  }
+
+  const sampled: T[] = [data[0]];
+  const bucketSize = (data.length - 2) / (threshold - 2);
+  let a = 0;
+
+  for (let i = 0; i < threshold - 2; i++) {
+    // Average of the next bucket, used as the third triangle vertex
+    const nextStart = Math.floor((i + 1) * bucketSize) + 1;
+    const nextEnd = Math.min(
+      Math.floor((i + 2) * bucketSize) + 1,
+      data.length,
+    );
+    let avgX = 0;
+    let avgY = 0;
+    for (let j = nextStart; j < nextEnd; j++) {
+      avgX += x(data[j]);
+      avgY += y(data[j]);
+    }
+    const nextLength = nextEnd - nextStart;
+    avgX /= nextLength;
+    avgY /= nextLength;
+
+    // Pick the point of the current bucket with the largest triangle area
+    const start = Math.floor(i * bucketSize) + 1;
+    const end = Math.floor((i + 1) * bucketSize) + 1;
+    const ax = x(data[a]);
+    const ay = y(data[a]);
+    let maxArea = -1;
+    let maxIndex = start;
+    for (let j = start; j < end; j++) {
+      const area = Math.abs(
+        (ax - avgX) * (y(data[j]) - ay) - (ax - x(data[j])) * (avgY - ay),
+      );
+      if (area > maxArea) {
+        maxArea = area;
+        maxIndex = j;
+      }
+    }
+
+    sampled.push(data[maxIndex]);
+    a = maxIndex;
+  }
+
+  sampled.push(data[data.length - 1]);
+  return sampled;
+}
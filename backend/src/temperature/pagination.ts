@@ -0,0 +1,66 @@
+import { BadRequestException } from '@nestjs/common';
+import { SQL, sql } from 'drizzle-orm';
+import { PgColumn } from 'drizzle-orm/pg-core';
+
+export const DEFAULT_PAGE_SIZE = 1000;
+export const MAX_PAGE_SIZE = 100_000;
+
+// Position of the last row of a page: its timestamp plus id as a tiebreaker.
+// The timestamp stays text with the microseconds Postgres stores; a Date
+// would round it to milliseconds and skip rows at page boundaries
+export interface Keyset {
+  at: string;
+  id: number;
+}
+
+export interface Page<T> {
+  items: T[];
+  nextCursor: string | null;
+}
+
+// A page row along with the exact timestamp it is ordered by
+export type Positioned<T> = T & { cursorAt: string };
+
+// Selected as "cursorAt" by page queries; ISO 8601 down to microseconds
+export const cursorAt = (column: PgColumn): SQL =>
+  sql`to_char(${column} AT TIME ZONE 'UTC', 'YYYY-MM-DD"T"HH24:MI:SS.US"Z"')`;
+
+export const keysetOf = (row: Positioned<{ id: number }>): Keyset => ({
+  at: row.cursorAt,
+  id: row.id,
+});
+
+export function withoutPosition<T>(row: Positioned<T>): T {
+  const item: Partial<Positioned<T>> = { ...row };
+  delete item.cursorAt;
+  return item as T;
+}
+
+export function encodeCursor({ at, id }: Keyset): string {
+  return Buffer.from(`${at}|${id}`).toString('base64url');
+}
+
+// Cursors issued before microsecond keysets carry milliseconds
+const CURSOR_TIME = /^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}\.\d{3}(\d{3})?Z$/;
+
+export function decodeCursor(cursor?: string): Keyset | null {
+  if (!cursor) return null;
+
+  const [at, id] = Buffer.from(cursor, 'base64url').toString().split('|');
+  const keyset = { at, id: Number(id) };
+
+  if (
+    !CURSOR_TIME.test(at) ||
+    isNaN(Date.parse(at)) ||
+    !Number.isInteger(keyset.id)
+  ) {
+    throw new BadRequestException('Invalid cursor');
+  }
+
+  return keyset;
+}
+
+export function clampPageSize(limit?: number, max = MAX_PAGE_SIZE): number {
+  if (!limit || !Number.isFinite(limit)) return DEFAULT_PAGE_SIZE;
+  return Math.min(Math.max(Math.floor(limit), 1), max);
+}
@@ -0,0 +1,191 @@
+import {
+  BadRequestException,
+  Controller,
+  Get,
+  Query,
+  Res,
+  UseGuards,
+} from '@nestjs/common';
+import type { Response } from 'express';
+import { HttpAuthGuard } from '../auth/http-auth.guard';
+import {
+  AggregateGranularity,
+  TemperatureService,
+} from './temperature.service';
+import {
+  Positioned,
+  clampPageSize,
+  decodeCursor,
+  encodeCursor,
+  keysetOf,
+  withoutPosition,
+} from './pagination';
+
+// Pages above this size are streamed from a server-side cursor
+const STREAM_THRESHOLD = 5000;
+
+const GRANULARITIES: AggregateGranularity[] = ['1m', '5m', '1h', '6h', '1d'];
+
+// Resolves once `res` drains or closes, leaving no listener behind
+function drained(res: Response): Promise<void> {
+  return new Promise((resolve) => {
+    const settle = () => {
+      res.off('drain', settle);
+      res.off('close', settle);
+      resolve();
+    };
+    res.on('drain', settle);
+    res.on('close', settle);
+  });
+}
+
+@Controller('temperature')
+@UseGuards(HttpAuthGuard)
+export class TemperatureController {
+  constructor(private readonly temperatureService: TemperatureService) {}
+
+  @Get('readings')
+  async getReadings(
+    @Res() res: Response,
+    @Query('deviceId') deviceId: string,
+    @Query('from') from: string,
+    @Query('to') to: string,
+    @Query('cursor') cursor?: string,
+    @Query('limit') limit?: string,
+  ) {
+    const range = this.parseRange(deviceId, from, to);
+    const pageSize = clampPageSize(limit ? parseInt(limit, 10) : undefined);
+
+    if (pageSize <= STREAM_THRESHOLD) {
+      res.json(
+        await this.temperatureService.getReadingsPage(
+          deviceId,
+          range.from,
+          range.to,
+          cursor,
+          pageSize,
+        ),
+      );
+      return;
+    }
+
+    await this.streamPage(
+      res,
+      this.temperatureService.streamReadingsPage(
+        deviceId,
+        range.from,
+        range.to,
+        decodeCursor(cursor),
+        pageSize + 1,
+      ),
+      pageSize,
+    );
+  }
+
+  @Get('aggregates')
+  async getAggregates(
+    @Res() res: Response,
+    @Query('deviceId') deviceId: string,
+    @Query('granularity') granularity: AggregateGranularity,
+    @Query('from') from: string,
+    @Query('to') to: string,
+    @Query('cursor') cursor?: string,
+    @Query('limit') limit?: string,
+  ) {
+    const range = this.parseRange(deviceId, from, to);
+    if (!GRANULARITIES.includes(granularity)) {
+      throw new BadRequestException('Invalid granularity');
+    }
+    const pageSize = clampPageSize(limit ? parseInt(limit, 10) : undefined);
+
+    if (pageSize <= STREAM_THRESHOLD) {
+      res.json(
+        await this.temperatureService.getAggregatesPage(
+          deviceId,
+          granularity,
+          range.from,
+          range.to,
+          cursor,
+          pageSize,
+        ),
+      );
+      return;
+    }
+
+    await this.streamPage(
+      res,
+      this.temperatureService.streamAggregatesPage(
+        deviceId,
+        granularity,
+        range.from,
+        range.to,
+        decodeCursor(cursor),
+        pageSize + 1,
+      ),
+      pageSize,
+    );
+  }
+
+  private parseRange(deviceId: string, from: string, to: string) {
+    const range = { from: new Date(from), to: new Date(to) };
+    if (
+      !deviceId ||
+      isNaN(range.from.getTime()) ||
+      isNaN(range.to.getTime())
+    ) {
+      throw new BadRequestException('deviceId, from and to are required');
+    }
+    return range;
+  }
+
+  /**
+   * Writes a `{ items, nextCursor }` document as rows arrive from the cursor,
+   * waiting for the socket to drain so memory stays flat for any page size.
+   * `batches` must yield up to `limit + 1` rows; the extra row only signals
+   * that another page exists. Answers 429 when too many pages are streaming.
+   */
+  private async streamPage<T extends { id: number }>(
+    res: Response,
+    batches: AsyncGenerator<Positioned<T>[]>,
+    limit: number,
+  ) {
+    const release = this.temperatureService.acquireStream();
+    res.status(200).type('application/json');
+    res.write('{"items":[');
+
+    let written = 0;
+    let last: Positioned<T> | null = null;
+    let hasMore = false;
+
+    try {
+      for await (const rows of batches) {
+        for (const row of rows) {
+          if (written === limit) {
+            hasMore = true;
+            break;
+          }
+          const chunk =
+            (written > 0 ? ',' : '') + JSON.stringify(withoutPosition(row));
+          written++;
+          last = row;
+          if (!res.write(chunk)) {
+            await drained(res);
+          }
+          if (res.destroyed) break;
+        }
+        if (hasMore || res.destroyed) break;
+      }
+    } catch (error) {
+      // Headers are already sent, so the only option is to abort the body
+      res.destroy(error instanceof Error ? error : undefined);
+      return;
+    } finally {
+      release();
+    }
+
+    if (res.destroyed) return;
+
+    const nextCursor = hasMore && last ? encodeCursor(keysetOf(last)) : null;
+    res.end(`],"nextCursor":${JSON.stringify(nextCursor)}}`);
+  }
+}
@@ -1,11 +1,14 @@
 import { Module } from '@nestjs/common';
 import { ScheduleModule } from '@nestjs/schedule';
 import { DbModule } from '../db/db.module';
+import { SupabaseModule } from '../auth/supabase.module';
 import { TemperatureService } from './temperature.service';
+import { TemperatureController } from './temperature.controller';
 import { AggregationScheduler } from './aggregation.scheduler';
 
 @Module({
-  imports: [DbModule, ScheduleModule.forRoot()],
+  imports: [DbModule, SupabaseModule, ScheduleModule.forRoot()],
+  controllers: [TemperatureController],
   providers: [TemperatureService, AggregationScheduler],
   exports: [TemperatureService],
 })
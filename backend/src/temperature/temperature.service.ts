@@ -1,7 +1,51 @@
-import { Injectable } from '@nestjs/common';
-import { and, desc, eq, gte, isNull, lte, sql } from 'drizzle-orm';
+import { HttpException, HttpStatus, Injectable } from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
+import { SQL, and, asc, desc, eq, gte, isNull, lte, sql } from 'drizzle-orm';
 import { DbClient } from '../db/client';
-import { temperatureReadings, temperatureAggregates } from '../db/schema';
+import {
+  devices,
+  locationAggregates,
+  locationClosure,
+  temperatureAggregates,
+  temperatureReadings,
+} from '../db/schema';
+import { lttb } from './downsample';
+import {
+  Keyset,
+  Page,
+  Positioned,
+  clampPageSize,
+  cursorAt,
+  decodeCursor,
+  encodeCursor,
+  keysetOf,
+  withoutPosition,
+} from './pagination';
+
+export type AggregateGranularity = '1m' | '5m' | '1h' | '6h' | '1d';
+
+// Bucket width of every stored aggregate tier, coarsest first
+const AGGREGATE_TIERS: { granularity: AggregateGranularity; ms: number }[] = [
+  { granularity: '1d', ms: 24 * 60 * 60 * 1000 },
+  { granularity: '6h', ms: 6 * 60 * 60 * 1000 },
+  { granularity: '1h', ms: 60 * 60 * 1000 },
+  { granularity: '5m', ms: 5 * 60 * 1000 },
+  { granularity: '1m', ms: 60 * 1000 },
+];
+
+export const DEFAULT_HISTORY_POINTS = 500;
+
+const MAX_LOCATION_AGGREGATES_PAGE = 5000;
+const MAX_HISTORY_POINTS = 5000;
+// Raw readings fetched per history point, leaving LTTB some to choose from
+const RAW_POINTS_PER_SAMPLE = 4;
+
+export function clampHistoryPoints(points?: number): number {
+  if (points === undefined || !Number.isFinite(points)) {
+    return DEFAULT_HISTORY_POINTS;
+  }
+  return Math.min(Math.max(Math.floor(points), 3), MAX_HISTORY_POINTS);
+}
 
 export interface TemperatureReading {
   id: number;
@@ -19,6 +63,23 @@ export interface TemperatureAggregate {
   deviceId: string | null;
 }
 
+export interface LocationAggregate {
+  id: number;
+  bucketStart: Date;
+  granularity: string;
+  avgC: number;
+  minC: number;
+  maxC: number;
+  avgHumidity: number | null;
+  readingCount: number;
+  deviceCount: number;
+}
+
+export interface TemperatureHistory {
+  granularity: AggregateGranularity | 'raw';
+  aggregates: TemperatureAggregate[];
+}
+
 export interface DeviceStats {
   deviceId: string;
   avgTemp: number;
@@ -28,16 +89,94 @@ export interface DeviceStats {
   readingCount: number;
 }
 
+// Start of the bucket a reading falls into, in the session time zone
+function bucketStartOf(granularity: AggregateGranularity): SQL<Date> {
+  const takenAt = temperatureReadings.takenAt;
+  switch (granularity) {
+    case '5m':
+      return sql<Date>`timestamptz 'epoch' + floor(extract(epoch from ${takenAt}) / 300) * 300 * interval '1 second'`;
+    case '6h':
+      return sql<Date>`timestamptz 'epoch' + floor(extract(epoch from ${takenAt}) / 21600) * 21600 * interval '1 second'`;
+    case '1m':
+      return sql<Date>`date_trunc('minute', ${takenAt})::timestamptz`;
+    case '1h':
+      return sql<Date>`date_trunc('hour', ${takenAt})::timestamptz`;
+    case '1d':
+      return sql<Date>`date_trunc('day', ${takenAt})::timestamptz`;
+  }
+}
+
+// Raw rows keep timestamps as strings when read through drizzle's execute()
+type Row<T> = { [K in keyof T]: T[K] extends Date ? Date | string : T[K] };
+
+function toReading(
+  row: Row<Positioned<TemperatureReading>>,
+): Positioned<TemperatureReading> {
+  return { ...row, takenAt: new Date(row.takenAt) };
+}
+
+function toAggregate(
+  row: Row<Positioned<TemperatureAggregate>>,
+): Positioned<TemperatureAggregate> {
+  return { ...row, bucketStart: new Date(row.bucketStart) };
+}
+
+// Fetches limit + 1 rows so the extra one tells whether another page exists
+function toPage<T extends { id: number }>(
+  rows: Positioned<T>[],
+  limit: number,
+): Page<T> {
+  const items = rows.slice(0, limit).map(withoutPosition);
+  if (rows.length <= limit) {
+    return { items, nextCursor: null };
+  }
+  return { items, nextCursor: encodeCursor(keysetOf(rows[limit - 1])) };
+}
+
 @Injectable()
 export class TemperatureService {
-  constructor(private readonly dbClient: DbClient) {}
+  private readonly maxStreams: number;
+  private activeStreams = 0;
+
+  constructor(
+    private readonly dbClient: DbClient,
+    configService: ConfigService,
+  ) {
+    this.maxStreams = Number(
+      configService.get<string>('PAGE_STREAM_MAX_CONCURRENCY') ?? 2,
+    );
+  }
+
+  /**
+   * Reserves one of the slots for streamed pages, which hold a pooled
+   * connection until the client has downloaded the whole page. Returns the
+   * release callback.
+   */
+  acquireStream(): () => void {
+    if (this.activeStreams >= this.maxStreams) {
+      throw new HttpException(
+        'Too many large pages in progress, try again later',
+        HttpStatus.TOO_MANY_REQUESTS,
+      );
+    }
+    this.activeStreams++;
+    let released = false;
+    return () => {
+      if (!released) {
+        released = true;
+        this.activeStreams--;
+      }
+    };
+  }
 
   async saveIfChanged(
     temperature: number,
     deviceId: string,
     deviceTimestamp: number,
     humidity?: number,
-  ) {
+    takenAt?: Date,
+    ingestId: string | null = null,
+  ): Promise<TemperatureReading | null> {
     const db = this.dbClient.db;
 
     const last = await db
@@ -65,37 +204,40 @@ export class TemperatureService {
         Number(lastHumidity.toFixed(2)) !== Number(humidity.toFixed(2)));
 
     if (!tempChanged && !humidityChanged) {
-      return; // unchanged within 0.01 precision
+      return null; // unchanged within 0.01 precision
     }
 
-    await db.insert(temperatureReadings).values({
-      temperatureC: temperature,
-      humidity: humidity ?? null,
-      deviceId,
-      deviceTimestamp: new Date(deviceTimestamp),
-    });
+    const [inserted] = await db
+      .insert(temperatureReadings)
+      .values({
+        temperatureC: temperature,
+        humidity: humidity ?? null,
+        deviceId,
+        deviceTimestamp: new Date(deviceTimestamp),
+        takenAt,
+        ingestId,
+      })
+      // A record replayed from the ingest WAL may already be stored
+      .onConflictDoNothing({ target: temperatureReadings.ingestId })
+      .returning({
+        id: temperatureReadings.id,
+        takenAt: temperatureReadings.takenAt,
+        temperatureC: temperatureReadings.temperatureC,
+        humidity: temperatureReadings.humidity,
+        deviceId: temperatureReadings.deviceId,
+      });
+
+    return (inserted as TemperatureReading | undefined) ?? null;
   }
+
   async aggregateAndStore(
-    granularity: '1m' | '5m' | '1h' | '6h' | '1d',
+    granularity: AggregateGranularity,
     from: Date,
     to: Date,
   ) {
     const db = this.dbClient.db;
 
-    const dateTrunc: Record<typeof granularity, string> = {
-      '1m': 'minute',
-      '5m': 'minute',
-      '1h': 'hour',
-      '6h': 'hour',
-      '1d': 'day',
-    } as const;
-
-    const bucketStart =
-      granularity === '5m'
-        ? sql<Date>`timestamptz 'epoch' + floor(extract(epoch from ${temperatureReadings.takenAt}) / 300) * 300 * interval '1 second'`
-        : granularity === '6h'
-          ? sql<Date>`timestamptz 'epoch' + floor(extract(epoch from ${temperatureReadings.takenAt}) / 21600) * 21600 * interval '1 second'`
-          : sql<Date>`date_trunc(${sql.raw(`'${dateTrunc[granularity]}'`)}, ${temperatureReadings.takenAt})::timestamptz`;
+    const bucketStart = bucketStartOf(granularity);
 
     const deviceIdsResult = await db
       .selectDistinct({ deviceId: temperatureReadings.deviceId })
@@ -169,6 +311,111 @@ export class TemperatureService {
     }
   }
 
+  /**
+   * Rebuilds the per-location tier for buckets touched by [from, to]. Each
+   * reading counts towards its device's location and every ancestor, so a
+   * building's row covers all of its floors and rooms. `from` is moved
+   * back to a bucket boundary so the first bucket is never stored partial.
+   */
+  async aggregateLocationsAndStore(
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+  ) {
+    const tier = AGGREGATE_TIERS.find((t) => t.granularity === granularity)!;
+    const start = new Date(Math.floor(from.getTime() / tier.ms) * tier.ms);
+    const bucketStart = bucketStartOf(granularity);
+
+    await this.dbClient.db.transaction(async (tx) => {
+      await tx
+        .delete(locationAggregates)
+        .where(
+          and(
+            eq(locationAggregates.granularity, granularity),
+            gte(
+              locationAggregates.bucketStart,
+              sql`${start.toISOString()}::timestamptz`,
+            ),
+            lte(
+              locationAggregates.bucketStart,
+              sql`${to.toISOString()}::timestamptz`,
+            ),
+          ),
+        );
+
+      await tx.execute(sql`
+        INSERT INTO ${locationAggregates} (
+          "location_id", "granularity", "bucket_start", "avg_c", "min_c",
+          "max_c", "avg_humidity", "reading_count", "device_count"
+        )
+        SELECT
+          ${locationClosure.ancestorId},
+          ${granularity},
+          ${bucketStart},
+          AVG(${temperatureReadings.temperatureC}),
+          MIN(${temperatureReadings.temperatureC}),
+          MAX(${temperatureReadings.temperatureC}),
+          AVG(${temperatureReadings.humidity}),
+          COUNT(*),
+          COUNT(DISTINCT ${temperatureReadings.deviceId})
+        FROM ${temperatureReadings}
+        JOIN ${devices} ON ${devices.id} = ${temperatureReadings.deviceId}
+        JOIN ${locationClosure}
+          ON ${locationClosure.descendantId} = ${devices.locationId}
+        WHERE ${temperatureReadings.takenAt} >= ${start.toISOString()}::timestamptz
+          AND ${temperatureReadings.takenAt} <= ${to.toISOString()}::timestamptz
+        GROUP BY ${locationClosure.ancestorId}, ${bucketStart}
+      `);
+    });
+  }
+
+  /**
+   * One page of a location's buckets, newest first. Pages are buffered
+   * rather than streamed, so they stay at MAX_LOCATION_AGGREGATES_PAGE.
+   */
+  async getLocationAggregatesPage(
+    locationId: number,
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+    cursor?: string,
+    limit?: number,
+  ): Promise<Page<LocationAggregate>> {
+    const pageSize = clampPageSize(limit, MAX_LOCATION_AGGREGATES_PAGE);
+    const after = decodeCursor(cursor);
+    const result = await this.dbClient.db.execute<
+      Row<Positioned<LocationAggregate>>
+    >(sql`
+      SELECT
+        ${locationAggregates.id} AS "id",
+        ${locationAggregates.bucketStart} AS "bucketStart",
+        ${locationAggregates.granularity} AS "granularity",
+        ${locationAggregates.avgC} AS "avgC",
+        ${locationAggregates.minC} AS "minC",
+        ${locationAggregates.maxC} AS "maxC",
+        ${locationAggregates.avgHumidity} AS "avgHumidity",
+        ${locationAggregates.readingCount} AS "readingCount",
+        ${locationAggregates.deviceCount} AS "deviceCount",
+        ${cursorAt(locationAggregates.bucketStart)} AS "cursorAt"
+      FROM ${locationAggregates}
+      WHERE ${locationAggregates.locationId} = ${locationId}
+        AND ${locationAggregates.granularity} = ${granularity}
+        AND ${locationAggregates.bucketStart} >= ${from.toISOString()}::timestamptz
+        AND ${locationAggregates.bucketStart} <= ${to.toISOString()}::timestamptz
+        ${after ? sql`AND (${locationAggregates.bucketStart}, ${locationAggregates.id}) < (${after.at}::timestamptz, ${after.id})` : sql``}
+      ORDER BY ${locationAggregates.bucketStart} DESC, ${locationAggregates.id} DESC
+      LIMIT ${sql.raw(String(pageSize + 1))}
+    `);
+
+    return toPage(
+      result.rows.map((row) => ({
+        ...row,
+        bucketStart: new Date(row.bucketStart),
+      })),
+      pageSize,
+    );
+  }
+
   async getLatestReadings(
     deviceIds?: string[],
     limit = 100,
@@ -221,78 +468,294 @@ export class TemperatureService {
     return result[0] ? (result[0] as TemperatureReading) : null;
   }
 
-  async getReadingsInRange(
+  async getAggregates(
     deviceId: string,
+    granularity: '1m' | '5m' | '1h' | '6h' | '1d',
     from: Date,
     to: Date,
     limit = 1000,
-  ): Promise<TemperatureReading[]> {
+  ): Promise<TemperatureAggregate[]> {
     const db = this.dbClient.db;
 
     const result = await db
       .select({
-        id: temperatureReadings.id,
-        takenAt: temperatureReadings.takenAt,
-        temperatureC: temperatureReadings.temperatureC,
-        humidity: temperatureReadings.humidity,
-        deviceId: temperatureReadings.deviceId,
+        id: temperatureAggregates.id,
+        bucketStart: temperatureAggregates.bucketStart,
+        granularity: temperatureAggregates.granularity,
+        medianC: temperatureAggregates.medianC,
+        deviceId: temperatureAggregates.deviceId,
       })
-      .from(temperatureReadings)
+      .from(temperatureAggregates)
       .where(
         and(
-          eq(temperatureReadings.deviceId, deviceId),
+          eq(temperatureAggregates.deviceId, deviceId),
+          eq(temperatureAggregates.granularity, granularity),
           gte(
-            temperatureReadings.takenAt,
+            temperatureAggregates.bucketStart,
             sql`${from.toISOString()}::timestamptz`,
           ),
           lte(
-            temperatureReadings.takenAt,
+            temperatureAggregates.bucketStart,
             sql`${to.toISOString()}::timestamptz`,
           ),
         ),
       )
-      .orderBy(desc(temperatureReadings.takenAt))
+      .orderBy(desc(temperatureAggregates.bucketStart))
       .limit(limit);
 
-    return result as TemperatureReading[];
+    return result as TemperatureAggregate[];
   }
 
-  async getAggregates(
+  /**
+   * Keyset-paginated readings for a device, newest first. `cursor` is the
+   * `nextCursor` of the previous page; pages are walked on the
+   * (device_id, taken_at) index instead of with OFFSET.
+   */
+  async getReadingsPage(
     deviceId: string,
-    granularity: '1m' | '5m' | '1h' | '6h' | '1d',
     from: Date,
     to: Date,
-    limit = 1000,
-  ): Promise<TemperatureAggregate[]> {
+    cursor?: string,
+    limit?: number,
+  ): Promise<Page<TemperatureReading>> {
+    const pageSize = clampPageSize(limit);
+    const result = await this.dbClient.db.execute<
+      Row<Positioned<TemperatureReading>>
+    >(
+      this.readingsPageQuery(
+        deviceId,
+        from,
+        to,
+        decodeCursor(cursor),
+        pageSize + 1,
+      ),
+    );
+
+    return toPage(result.rows.map(toReading), pageSize);
+  }
+
+  /**
+   * Same rows as getReadingsPage, but read through a server-side cursor in
+   * batches. Used for large pages that should not be materialized at once.
+   */
+  async *streamReadingsPage(
+    deviceId: string,
+    from: Date,
+    to: Date,
+    after: Keyset | null,
+    limit: number,
+  ): AsyncGenerator<Positioned<TemperatureReading>[]> {
+    const query = this.readingsPageQuery(deviceId, from, to, after, limit);
+    for await (const rows of this.dbClient.cursor<
+      Row<Positioned<TemperatureReading>>
+    >(query)) {
+      yield rows.map(toReading);
+    }
+  }
+
+  async getAggregatesPage(
+    deviceId: string,
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+    cursor?: string,
+    limit?: number,
+  ): Promise<Page<TemperatureAggregate>> {
+    const pageSize = clampPageSize(limit);
+    const result = await this.dbClient.db.execute<
+      Row<Positioned<TemperatureAggregate>>
+    >(
+      this.aggregatesPageQuery(
+        deviceId,
+        granularity,
+        from,
+        to,
+        decodeCursor(cursor),
+        pageSize + 1,
+      ),
+    );
+
+    return toPage(result.rows.map(toAggregate), pageSize);
+  }
+
+  async *streamAggregatesPage(
+    deviceId: string,
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+    after: Keyset | null,
+    limit: number,
+  ): AsyncGenerator<Positioned<TemperatureAggregate>[]> {
+    const query = this.aggregatesPageQuery(
+      deviceId,
+      granularity,
+      from,
+      to,
+      after,
+      limit,
+    );
+    for await (const rows of this.dbClient.cursor<
+      Row<Positioned<TemperatureAggregate>>
+    >(query)) {
+      yield rows.map(toAggregate);
+    }
+  }
+
+  private readingsPageQuery(
+    deviceId: string,
+    from: Date,
+    to: Date,
+    after: Keyset | null,
+    limit: number,
+  ): SQL {
+    return sql`
+      SELECT
+        ${temperatureReadings.id} AS "id",
+        ${temperatureReadings.takenAt} AS "takenAt",
+        ${temperatureReadings.temperatureC} AS "temperatureC",
+        ${temperatureReadings.humidity} AS "humidity",
+        ${temperatureReadings.deviceId} AS "deviceId",
+        ${cursorAt(temperatureReadings.takenAt)} AS "cursorAt"
+      FROM ${temperatureReadings}
+      WHERE ${temperatureReadings.deviceId} = ${deviceId}
+        AND ${temperatureReadings.takenAt} >= ${from.toISOString()}::timestamptz
+        AND ${temperatureReadings.takenAt} <= ${to.toISOString()}::timestamptz
+        ${after ? sql`AND (${temperatureReadings.takenAt}, ${temperatureReadings.id}) < (${after.at}::timestamptz, ${after.id})` : sql``}
+      ORDER BY ${temperatureReadings.takenAt} DESC, ${temperatureReadings.id} DESC
+      LIMIT ${sql.raw(String(limit))}
+    `;
+  }
+
+  private aggregatesPageQuery(
+    deviceId: string,
+    granularity: AggregateGranularity,
+    from: Date,
+    to: Date,
+    after: Keyset | null,
+    limit: number,
+  ): SQL {
+    return sql`
+      SELECT
+        ${temperatureAggregates.id} AS "id",
+        ${temperatureAggregates.bucketStart} AS "bucketStart",
+        ${temperatureAggregates.granularity} AS "granularity",
+        ${temperatureAggregates.medianC} AS "medianC",
+        ${temperatureAggregates.deviceId} AS "deviceId",
+        ${cursorAt(temperatureAggregates.bucketStart)} AS "cursorAt"
+      FROM ${temperatureAggregates}
+      WHERE ${temperatureAggregates.deviceId} = ${deviceId}
+        AND ${temperatureAggregates.granularity} = ${granularity}
+        AND ${temperatureAggregates.bucketStart} >= ${from.toISOString()}::timestamptz
+        AND ${temperatureAggregates.bucketStart} <= ${to.toISOString()}::timestamptz
+        ${after ? sql`AND (${temperatureAggregates.bucketStart}, ${temperatureAggregates.id}) < (${after.at}::timestamptz, ${after.id})` : sql``}
+      ORDER BY ${temperatureAggregates.bucketStart} DESC, ${temperatureAggregates.id} DESC
+      LIMIT ${sql.raw(String(limit))}
+    `;
+  }
+
+  /**
+   * Returns a chart-ready series of at most `points` samples for the range.
+   * Reads from the coarsest tier that still yields `points` buckets (raw
+   * readings when no tier is fine enough), then applies LTTB downsampling.
+   * Raw readings are returned in the aggregate shape with granularity 'raw'.
+   */
+  async getHistory(
+    deviceId: string,
+    from: Date,
+    to: Date,
+    points = DEFAULT_HISTORY_POINTS,
+  ): Promise<TemperatureHistory> {
+    const target = clampHistoryPoints(points);
+    const granularity = this.selectResolution(from, to, target);
+
+    let series: TemperatureAggregate[];
+    if (granularity === 'raw') {
+      const readings = await this.getRawSeries(
+        deviceId,
+        from,
+        to,
+        target * RAW_POINTS_PER_SAMPLE,
+      );
+      series = readings.map((r) => ({
+        id: r.id,
+        bucketStart: r.takenAt,
+        granularity: 'raw',
+        medianC: r.temperatureC,
+        deviceId: r.deviceId,
+      }));
+    } else {
+      const tier = AGGREGATE_TIERS.find((t) => t.granularity === granularity)!;
+      const bucketCount = Math.ceil((to.getTime() - from.getTime()) / tier.ms);
+      const aggregates = await this.getAggregates(
+        deviceId,
+        granularity,
+        from,
+        to,
+        bucketCount + 1,
+      );
+      series = aggregates.reverse();
+    }
+
+    return {
+      granularity,
+      aggregates: lttb(
+        series,
+        target,
+        (a) => a.bucketStart.getTime(),
+        (a) => a.medianC,
+      ),
+    };
+  }
+
+  selectResolution(
+    from: Date,
+    to: Date,
+    points: number,
+  ): AggregateGranularity | 'raw' {
+    const spacing = (to.getTime() - from.getTime()) / points;
+    const tier = AGGREGATE_TIERS.find((t) => t.ms <= spacing);
+    return tier ? tier.granularity : 'raw';
+  }
+
+  // At most `samples` readings: the first of each of as many equal slices
+  // of the range, so a busy device cannot make the result unbounded
+  private async getRawSeries(
+    deviceId: string,
+    from: Date,
+    to: Date,
+    samples: number,
+  ): Promise<TemperatureReading[]> {
     const db = this.dbClient.db;
+    const sliceMs = Math.max((to.getTime() - from.getTime()) / samples, 1);
+    // Inlined so DISTINCT ON and ORDER BY use the identical expression
+    const slice = sql`floor(extract(epoch from ${temperatureReadings.takenAt}) * 1000 / ${sql.raw(String(sliceMs))})`;
 
     const result = await db
-      .select({
-        id: temperatureAggregates.id,
-        bucketStart: temperatureAggregates.bucketStart,
-        granularity: temperatureAggregates.granularity,
-        medianC: temperatureAggregates.medianC,
-        deviceId: temperatureAggregates.deviceId,
+      .selectDistinctOn([slice], {
+        id: temperatureReadings.id,
+        takenAt: temperatureReadings.takenAt,
+        temperatureC: temperatureReadings.temperatureC,
+        humidity: temperatureReadings.humidity,
+        deviceId: temperatureReadings.deviceId,
       })
-      .from(temperatureAggregates)
+      .from(temperatureReadings)
       .where(
         and(
-          eq(temperatureAggregates.deviceId, deviceId),
-          eq(temperatureAggregates.granularity, granularity),
+          eq(temperatureReadings.deviceId, deviceId),
           gte(
-            temperatureAggregates.bucketStart,
+            temperatureReadings.takenAt,
             sql`${from.toISOString()}::timestamptz`,
           ),
           lte(
-            temperatureAggregates.bucketStart,
+            temperatureReadings.takenAt,
             sql`${to.toISOString()}::timestamptz`,
           ),
         ),
       )
-      .orderBy(desc(temperatureAggregates.bucketStart))
-      .limit(limit);
+      .orderBy(slice, asc(temperatureReadings.takenAt))
+      .limit(samples + 1);
 
-    return result as TemperatureAggregate[];
+    return result as TemperatureReading[];
   }
 
   async getDeviceStats(
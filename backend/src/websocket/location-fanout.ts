@@ -0,0 +1,62 @@
+/**
+ * Device membership of every location someone is watching, indexed both
+ * ways: a location's devices for subscription replies, and a device's
+ * watched locations for routing each update to their shared rooms.
+ */
+export class LocationFanout {
+  private readonly members = new Map<number, Set<string>>();
+  private readonly byDevice = new Map<string, Set<number>>();
+
+  // Replaces a location's members; returns false if nothing changed
+  set(locationId: number, deviceIds: string[]): boolean {
+    const previous = this.members.get(locationId);
+    const next = new Set(deviceIds);
+    if (
+      previous &&
+      previous.size === next.size &&
+      deviceIds.every((id) => previous.has(id))
+    ) {
+      return false;
+    }
+
+    this.remove(locationId);
+    this.members.set(locationId, next);
+    for (const deviceId of next) {
+      let locations = this.byDevice.get(deviceId);
+      if (!locations) {
+        locations = new Set();
+        this.byDevice.set(deviceId, locations);
+      }
+      locations.add(locationId);
+    }
+    return true;
+  }
+
+  remove(locationId: number): void {
+    const previous = this.members.get(locationId);
+    if (!previous) return;
+
+    this.members.delete(locationId);
+    for (const deviceId of previous) {
+      const locations = this.byDevice.get(deviceId)!;
+      locations.delete(locationId);
+      if (locations.size === 0) this.byDevice.delete(deviceId);
+    }
+  }
+
+  has(locationId: number): boolean {
+    return this.members.has(locationId);
+  }
+
+  membersOf(locationId: number): ReadonlySet<string> {
+    return this.members.get(locationId) ?? new Set();
+  }
+
+  locationsOf(deviceId: string): ReadonlySet<number> {
+    return this.byDevice.get(deviceId) ?? new Set();
+  }
+
+  watched(): number[] {
+    return Array.from(this.members.keys());
+  }
+}
@@ -0,0 +1,168 @@
+import { Server, Socket } from 'socket.io';
+import { MetricsService } from '../metrics/metrics.service';
+import {
+  EmittedTrace,
+  LatencyTracer,
+  TelemetryTrace,
+} from '../metrics/latency-tracer';
+import { MAX_FRAME_DEVICES, encodeTelemetryFrame } from './telemetry-codec';
+
+export interface TelemetryUpdate {
+  deviceId: string;
+  temperatureC: number;
+  humidity: number | null;
+  // Epoch milliseconds
+  timestamp: number;
+  // Not sent in frames; sampled traces go out as `telemetry:trace`
+  trace?: TelemetryTrace;
+}
+
+export interface TelemetryClientState {
+  // Latest update per device since the last frame; older values are dropped
+  pending: Map<string, TelemetryUpdate>;
+  lastFlushAt: number;
+  minIntervalMs: number;
+  // Binary clients get `telemetry:frame` keyed by their device index
+  binary: boolean;
+  epoch: number;
+  deviceIndex: Map<string, number>;
+  // Sampled traces sent to this client and not reported back yet, by id
+  traces: Map<number, EmittedTrace>;
+  nextTraceId: number;
+}
+
+export interface TelemetryBatcherOptions {
+  intervalMs: number;
+  maxBufferedPackets: number;
+}
+
+type TelemetrySocket = Socket & { data: { telemetry?: TelemetryClientState } };
+
+// Older traces are forgotten, as their reports are not coming
+const MAX_OUTSTANDING_TRACES = 32;
+
+/**
+ * Coalesces device updates into one `telemetry:batch` frame per client per
+ * tick. Each client holds at most one pending value per device, so a client
+ * that is slow to read, or that asked for a lower rate, skips ticks and then
+ * receives only the latest values instead of a growing backlog.
+ */
+export class TelemetryBatcher {
+  private readonly dirty = new Set<TelemetrySocket>();
+  private timer: NodeJS.Timeout | null = null;
+
+  constructor(
+    private readonly server: Server,
+    private readonly options: TelemetryBatcherOptions,
+    private readonly metrics: MetricsService,
+    private readonly tracer: LatencyTracer,
+  ) {}
+
+  start(): void {
+    this.timer = setInterval(() => this.flush(), this.options.intervalMs);
+  }
+
+  stop(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  enqueue(room: string, update: TelemetryUpdate): void {
+    const members = this.server.sockets.adapter.rooms.get(room);
+    if (!members) return;
+
+    for (const socketId of members) {
+      const client = this.server.sockets.sockets.get(socketId) as
+        | TelemetrySocket
+        | undefined;
+      const state = client?.data.telemetry;
+      if (!client || !state) continue;
+
+      state.pending.set(update.deviceId, update);
+      this.dirty.add(client);
+    }
+  }
+
+  // Drops pending values for devices the client no longer follows
+  discard(client: TelemetrySocket, deviceIds: string[]): void {
+    deviceIds.forEach((deviceId) =>
+      client.data.telemetry?.pending.delete(deviceId),
+    );
+  }
+
+  private flush(): void {
+    if (this.dirty.size === 0) return;
+    const now = Date.now();
+    const done = this.metrics.wsFlushSeconds.startTimer();
+
+    for (const client of this.dirty) {
+      const state = client.data.telemetry;
+      if (!client.connected || !state || state.pending.size === 0) {
+        this.dirty.delete(client);
+        continue;
+      }
+
+      if (now - state.lastFlushAt < state.minIntervalMs) continue;
+
+      // Earlier frames are still queued on the transport; wait for it
+      if (client.conn.writeBuffer.length > this.options.maxBufferedPackets) {
+        continue;
+      }
+
+      const updates = Array.from(state.pending.values());
+      // Too many followed devices to index; see reindex in the gateway
+      const binary =
+        state.binary && state.deviceIndex.size <= MAX_FRAME_DEVICES;
+      const format = binary ? 'binary' : 'json';
+      this.metrics.wsFrames.inc({ format });
+      this.metrics.wsFrameUpdates.inc({ format }, updates.length);
+      if (binary) {
+        client.emit(
+          'telemetry:frame',
+          encodeTelemetryFrame(state.epoch, updates, state.deviceIndex),
+        );
+      } else {
+        client.emit(
+          'telemetry:batch',
+          updates.map(({ deviceId, temperatureC, humidity, timestamp }) => ({
+            deviceId,
+            temperatureC,
+            humidity,
+            timestamp,
+          })),
+        );
+      }
+      this.emitTraces(client, state, updates, now);
+      state.pending.clear();
+      state.lastFlushAt = now;
+      this.dirty.delete(client);
+    }
+    done();
+  }
+
+  private emitTraces(
+    client: TelemetrySocket,
+    state: TelemetryClientState,
+    updates: TelemetryUpdate[],
+    emittedAt: number,
+  ) {
+    for (const { deviceId, trace } of updates) {
+      if (!trace?.sampled) continue;
+      this.tracer.emitted(trace, emittedAt);
+
+      const traceId = state.nextTraceId++;
+      state.traces.set(traceId, { deviceAt: trace.deviceAt, emittedAt });
+      if (state.traces.size > MAX_OUTSTANDING_TRACES) {
+        state.traces.delete(state.traces.keys().next().value!);
+      }
+      client.emit('telemetry:trace', {
+        traceId,
+        deviceId,
+        deviceAt: trace.deviceAt,
+        receivedAt: trace.receivedAt,
+        committedAt: trace.committedAt,
+        emittedAt,
+      });
+    }
+  }
+}
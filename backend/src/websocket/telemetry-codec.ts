@@ -0,0 +1,49 @@
+import { TelemetryUpdate } from './telemetry-batcher';
+
+/**
+ * Compact binary layout for `telemetry:frame`, little-endian:
+ *
+ *   header  u8 version | u16 index epoch | f64 base time (ms) | u16 count
+ *   entry   u16 device index | f32 temperature | f32 humidity (NaN = null)
+ *           | i32 offset from base time (ms)
+ *
+ * Device ids are replaced by their position in the list sent with the
+ * matching `telemetry:index` epoch, so a frame costs 14 bytes per device.
+ * Keep in sync with frontend/src/lib/telemetry-codec.ts.
+ */
+export const TELEMETRY_FRAME_VERSION = 1;
+// Device indexes and the entry count are u16
+export const MAX_FRAME_DEVICES = 0xffff;
+const HEADER_BYTES = 13;
+const ENTRY_BYTES = 14;
+
+export function encodeTelemetryFrame(
+  epoch: number,
+  updates: TelemetryUpdate[],
+  deviceIndex: Map<string, number>,
+): Buffer {
+  const entries = updates.filter((u) => deviceIndex.has(u.deviceId));
+  const base = entries.reduce(
+    (min, u) => Math.min(min, u.timestamp),
+    entries[0]?.timestamp ?? Date.now(),
+  );
+
+  const buffer = Buffer.allocUnsafe(
+    HEADER_BYTES + entries.length * ENTRY_BYTES,
+  );
+  buffer.writeUInt8(TELEMETRY_FRAME_VERSION, 0);
+  buffer.writeUInt16LE(epoch & 0xffff, 1);
+  buffer.writeDoubleLE(base, 3);
+  buffer.writeUInt16LE(entries.length, 11);
+
+  let offset = HEADER_BYTES;
+  for (const update of entries) {
+    buffer.writeUInt16LE(deviceIndex.get(update.deviceId)!, offset);
+    buffer.writeFloatLE(update.temperatureC, offset + 2);
+    buffer.writeFloatLE(update.humidity ?? NaN, offset + 6);
+    buffer.writeInt32LE(update.timestamp - base, offset + 10);
+    offset += ENTRY_BYTES;
+  }
+
+  return buffer;
+}
@@ -9,16 +9,37 @@ import {
   OnGatewayInit,
 } from '@nestjs/websockets';
 import { Server, Socket } from 'socket.io';
-import { Logger, UseGuards } from '@nestjs/common';
+import { Logger, OnModuleDestroy, UseGuards } from '@nestjs/common';
+import { ConfigService } from '@nestjs/config';
 import { WsAuthGuard } from '../auth/ws-auth.guard';
 import { SupabaseService } from '../auth/supabase.service';
 import { User } from '@supabase/supabase-js';
-import { DevicesService, Device } from '../devices/devices.service';
-import { TemperatureService } from '../temperature/temperature.service';
-import { LocationsService } from '../locations/locations.service';
+import { Device } from '../devices/devices.service';
+import { DeviceSnapshotService } from '../devices/device-snapshot.service';
+import {
+  AggregateGranularity,
+  TemperatureService,
+  clampHistoryPoints,
+} from '../temperature/temperature.service';
+import { clampPageSize } from '../temperature/pagination';
+import { MetricsService } from '../metrics/metrics.service';
+import {
+  LatencyTracer,
+  TelemetryTrace,
+  TraceReport,
+} from '../metrics/latency-tracer';
+import {
+  TelemetryBatcher,
+  TelemetryClientState,
+} from './telemetry-batcher';
+import { MAX_FRAME_DEVICES } from './telemetry-codec';
+import { LocationRollupService } from '../locations/location-rollup.service';
+import { LocationFanout } from './location-fanout';
 
 interface SocketAuth {
   token?: string;
+  // 'binary' opts into compact telemetry:frame updates
+  protocol?: string;
 }
 
 export interface AuthenticatedSocket extends Socket {
@@ -26,9 +47,18 @@ export interface AuthenticatedSocket extends Socket {
   data: {
     user?: User;
     subscribedDevices?: Set<string>;
+    subscribedLocations?: Set<number>;
+    telemetry?: TelemetryClientState;
   };
 }
 
+const deviceRoom = (deviceId: string) => `device:${deviceId}`;
+// Shared by everyone watching the location, whatever devices it holds
+const locationRoom = (locationId: number) => `location:${locationId}`;
+
+// Socket frames are built in memory, so larger pages must go through REST
+const MAX_WS_PAGE_SIZE = 5000;
+
 @WebSocketGateway({
   cors: {
     origin: [process.env.PUBLIC_FRONTEND_URL ?? 'http://localhost:3001'],
@@ -36,24 +66,74 @@ export interface AuthenticatedSocket extends Socket {
   },
 })
 export class WebsocketGateway
-  implements OnGatewayInit, OnGatewayConnection, OnGatewayDisconnect
+  implements
+    OnGatewayInit,
+    OnGatewayConnection,
+    OnGatewayDisconnect,
+    OnModuleDestroy
 {
   @WebSocketServer()
   server: Server;
 
   private logger = new Logger('WebsocketGateway');
+  private batcher: TelemetryBatcher;
+  private clientMinIntervalMs: number;
+  private readonly locationFanout = new LocationFanout();
+  // Last `location:stats` payload per room, to skip unchanged frames
+  private readonly lastLocationStats = new Map<number, string>();
+  private locationStatsTimer: NodeJS.Timeout | null = null;
+  private membershipTimer: NodeJS.Timeout | null = null;
 
   constructor(
+    private configService: ConfigService,
     private supabaseService: SupabaseService,
-    private devicesService: DevicesService,
+    private deviceSnapshotService: DeviceSnapshotService,
     private temperatureService: TemperatureService,
-    private locationsService: LocationsService,
+    private metricsService: MetricsService,
+    private latencyTracer: LatencyTracer,
+    private locationRollupService: LocationRollupService,
   ) {}
 
-  afterInit() {
+  afterInit(server: Server) {
+    this.batcher = new TelemetryBatcher(
+      server,
+      {
+        intervalMs: Number(
+          this.configService.get<string>('TELEMETRY_BATCH_INTERVAL_MS') ?? 250,
+        ),
+        maxBufferedPackets: Number(
+          this.configService.get<string>('TELEMETRY_MAX_BUFFERED_PACKETS') ??
+            16,
+        ),
+      },
+      this.metricsService,
+      this.latencyTracer,
+    );
+    const { wsClients } = this.metricsService;
+    wsClients.collect(() => wsClients.set(server.sockets.sockets.size));
+    this.clientMinIntervalMs = Number(
+      this.configService.get<string>('TELEMETRY_CLIENT_MIN_INTERVAL_MS') ?? 0,
+    );
+    this.batcher.start();
+
+    this.locationStatsTimer = setInterval(
+      () => void this.emitLocationStats(),
+      Number(
+        this.configService.get<string>('LOCATION_STATS_INTERVAL_MS') ?? 5000,
+      ),
+    );
+    this.locationRollupService.onChange(() =>
+      this.scheduleMembershipRefresh(),
+    );
     this.logger.log('WebSocket Gateway initialized');
   }
 
+  onModuleDestroy() {
+    this.batcher?.stop();
+    if (this.locationStatsTimer) clearInterval(this.locationStatsTimer);
+    if (this.membershipTimer) clearTimeout(this.membershipTimer);
+  }
+
   async handleConnection(client: AuthenticatedSocket) {
     this.logger.log(`Client attempting to connect: ${client.id}`);
 
@@ -78,6 +158,17 @@ export class WebsocketGateway
 
       client.data.user = user;
       client.data.subscribedDevices = new Set<string>();
+      client.data.subscribedLocations = new Set<number>();
+      client.data.telemetry = {
+        pending: new Map(),
+        lastFlushAt: 0,
+        minIntervalMs: this.clientMinIntervalMs,
+        binary: client.handshake.auth?.protocol === 'binary',
+        epoch: 0,
+        deviceIndex: new Map(),
+        traces: new Map(),
+        nextTraceId: 0,
+      };
       this.logger.log(
         `Client connected: ${client.id} (User: ${user.email || user.id})`,
       );
@@ -165,43 +256,8 @@ export class WebsocketGateway
     );
 
     try {
-      const userId = client.data.user?.id;
-      const devices = await this.devicesService.findAllActive();
-
-      const devicesWithTemp = await Promise.all(
-        devices.map(async (device) => {
-          const latestReading = await this.temperatureService.getLatestByDevice(
-            device.id,
-          );
-
-          // Fetch location information if device has a locationId
-          let location = null;
-          if (device.locationId && userId) {
-            try {
-              location = await this.locationsService.findById(
-                device.locationId,
-                userId,
-              );
-            } catch {
-              // Location not found or access denied
-            }
-          }
-
-          return {
-            ...device,
-            currentTemperature: latestReading?.temperatureC || null,
-            currentHumidity: latestReading?.humidity || null,
-            lastReading: latestReading?.takenAt || null,
-            location: location
-              ? {
-                  id: location.id,
-                  name: location.name,
-                  type: location.type,
-                  description: location.description,
-                }
-              : null,
-          };
-        }),
+      const devicesWithTemp = await this.deviceSnapshotService.getActive(
+        client.data.user?.id,
       );
 
       return {
@@ -229,7 +285,16 @@ export class WebsocketGateway
       `Device subscription from ${client.id}: ${payload.deviceIds.join(', ')}`,
     );
 
-    client.data.subscribedDevices = new Set(payload.deviceIds);
+    // Subscriptions replace the previous set; each device maps to a room so
+    // broadcasts only touch the sockets that actually subscribed
+    const previous = client.data.subscribedDevices ?? new Set<string>();
+    const next = new Set(payload.deviceIds);
+    const dropped = Array.from(previous).filter((id) => !next.has(id));
+    dropped.forEach((deviceId) => void client.leave(deviceRoom(deviceId)));
+    await client.join(payload.deviceIds.map(deviceRoom));
+    client.data.subscribedDevices = next;
+    this.prune(client);
+    this.reindex(client);
 
     try {
       const readings = await Promise.all(
@@ -269,7 +334,10 @@ export class WebsocketGateway
 
     payload.deviceIds.forEach((deviceId) => {
       client.data.subscribedDevices?.delete(deviceId);
+      void client.leave(deviceRoom(deviceId));
     });
+    this.prune(client);
+    this.reindex(client);
 
     return {
       event: 'devices:unsubscribed',
@@ -277,11 +345,131 @@ export class WebsocketGateway
     };
   }
 
+  /**
+   * Follows every device under the given locations, resolved server-side
+   * and kept current as devices move. Besides per-device telemetry, each
+   * location room gets a periodic `location:stats` frame.
+   */
+  @UseGuards(WsAuthGuard)
+  @SubscribeMessage('locations:subscribe')
+  async handleSubscribeToLocations(
+    @ConnectedSocket() client: AuthenticatedSocket,
+    @MessageBody() payload: { locationIds: number[] },
+  ) {
+    this.logger.log(
+      `Location subscription from ${client.id}: ${payload.locationIds.join(', ')}`,
+    );
+
+    try {
+      // Locations of other owners are silently left out
+      const subtrees = await this.locationRollupService.getSubtrees(
+        payload.locationIds,
+        client.data.user!.id,
+      );
+
+      // Like devices:subscribe, the new set replaces the previous one
+      const previous = client.data.subscribedLocations ?? new Set<number>();
+      const next = new Set(subtrees.keys());
+      previous.forEach((locationId) => {
+        if (!next.has(locationId)) void client.leave(locationRoom(locationId));
+      });
+      for (const [locationId, { deviceIds }] of subtrees) {
+        if (!this.locationFanout.has(locationId)) {
+          this.locationFanout.set(locationId, deviceIds);
+        }
+      }
+      await client.join(Array.from(next, locationRoom));
+      client.data.subscribedLocations = next;
+      this.prune(client);
+      this.reindex(client);
+
+      return {
+        event: 'locations:initial',
+        data: Array.from(subtrees, ([locationId, subtree]) => ({
+          locationId,
+          deviceIds: subtree.deviceIds,
+          stats: subtree.stats,
+        })),
+      };
+    } catch (error) {
+      const errorMessage =
+        error instanceof Error ? error.message : 'Unknown error';
+      this.logger.error(`Error subscribing to locations: ${errorMessage}`);
+      return {
+        event: 'error',
+        data: { message: 'Failed to subscribe to locations' },
+      };
+    }
+  }
+
+  @UseGuards(WsAuthGuard)
+  @SubscribeMessage('locations:unsubscribe')
+  handleUnsubscribeFromLocations(
+    @ConnectedSocket() client: AuthenticatedSocket,
+    @MessageBody() payload: { locationIds: number[] },
+  ) {
+    payload.locationIds.forEach((locationId) => {
+      client.data.subscribedLocations?.delete(locationId);
+      void client.leave(locationRoom(locationId));
+    });
+    this.prune(client);
+    this.reindex(client);
+
+    return {
+      event: 'locations:unsubscribed',
+      data: { locationIds: payload.locationIds },
+    };
+  }
+
+  @UseGuards(WsAuthGuard)
+  @SubscribeMessage('telemetry:configure')
+  handleConfigureTelemetry(
+    @ConnectedSocket() client: AuthenticatedSocket,
+    @MessageBody() payload: { maxFramesPerSecond?: number },
+  ) {
+    const state = client.data.telemetry;
+    if (!state) return;
+
+    // Clients may only ask for fewer frames than the server default
+    const requested =
+      payload.maxFramesPerSecond && payload.maxFramesPerSecond > 0
+        ? 1000 / payload.maxFramesPerSecond
+        : 0;
+    state.minIntervalMs = Math.max(requested, this.clientMinIntervalMs);
+
+    return {
+      event: 'telemetry:configured',
+      data: { minIntervalMs: state.minIntervalMs },
+    };
+  }
+
+  // Receive and render times for a sampled `telemetry:trace`
+  @UseGuards(WsAuthGuard)
+  @SubscribeMessage('telemetry:trace')
+  handleTelemetryTrace(
+    @ConnectedSocket() client: AuthenticatedSocket,
+    @MessageBody() payload: TraceReport,
+  ) {
+    // Only traces this socket was sent count, and each only once
+    const traces = client.data.telemetry?.traces;
+    const trace = traces?.get(payload?.traceId);
+    if (!trace) return;
+    traces!.delete(payload.traceId);
+    this.latencyTracer.report(trace, payload);
+  }
+
   @UseGuards(WsAuthGuard)
   @SubscribeMessage('temperature:history')
   async handleGetTemperatureHistory(
     @ConnectedSocket() client: AuthenticatedSocket,
-    @MessageBody() payload: { deviceId: string; from: string; to: string },
+    @MessageBody()
+    payload: {
+      deviceId: string;
+      from: string;
+      to: string;
+      cursor?: string;
+      limit?: number;
+    },
   ) {
     this.logger.log(
       `Temperature history request from ${client.id} for device ${payload.deviceId}`,
@@ -291,17 +479,20 @@ export class WebsocketGateway
       const from = new Date(payload.from);
       const to = new Date(payload.to);
 
-      const readings = await this.temperatureService.getReadingsInRange(
+      const page = await this.temperatureService.getReadingsPage(
         payload.deviceId,
         from,
         to,
+        payload.cursor,
+        clampPageSize(payload.limit, MAX_WS_PAGE_SIZE),
       );
 
       return {
         event: 'temperature:history',
         data: {
           deviceId: payload.deviceId,
-          readings,
+          readings: page.items,
+          nextCursor: page.nextCursor,
         },
       };
     } catch (error) {
@@ -355,9 +546,12 @@ export class WebsocketGateway
     @MessageBody()
     payload: {
       deviceId: string;
-      granularity: '1m' | '5m' | '1h' | '6h' | '1d';
+      granularity?: AggregateGranularity;
+      points?: number;
       from: string;
       to: string;
+      cursor?: string;
+      limit?: number;
     },
   ) {
     this.logger.log(
@@ -368,11 +562,32 @@ export class WebsocketGateway
       const from = new Date(payload.from);
       const to = new Date(payload.to);
 
-      const aggregates = await this.temperatureService.getAggregates(
+      // Without an explicit tier, pick one and downsample to `points`
+      if (!payload.granularity) {
+        const history = await this.temperatureService.getHistory(
+          payload.deviceId,
+          from,
+          to,
+          clampHistoryPoints(payload.points),
+        );
+
+        return {
+          event: 'aggregates:data',
+          data: {
+            deviceId: payload.deviceId,
+            granularity: history.granularity,
+            aggregates: history.aggregates,
+          },
+        };
+      }
+
+      const page = await this.temperatureService.getAggregatesPage(
         payload.deviceId,
         payload.granularity,
         from,
         to,
+        payload.cursor,
+        clampPageSize(payload.limit, MAX_WS_PAGE_SIZE),
       );
 
       return {
@@ -380,7 +595,8 @@ export class WebsocketGateway
         data: {
           deviceId: payload.deviceId,
           granularity: payload.granularity,
-          aggregates,
+          aggregates: page.items,
+          nextCursor: page.nextCursor,
         },
       };
     } catch (error) {
@@ -398,24 +614,24 @@ export class WebsocketGateway
     deviceId: string,
     temperature: number,
     humidity?: number,
+    trace?: TelemetryTrace,
   ) {
-    const clients = Array.from(
-      this.server.sockets.sockets.values(),
-    ) as AuthenticatedSocket[];
-
-    clients.forEach((client) => {
-      if (client.data.subscribedDevices?.has(deviceId)) {
-        client.emit('temperature:update', {
-          deviceId,
-          temperatureC: temperature,
-          humidity: humidity ?? null,
-          timestamp: new Date().toISOString(),
-        });
-      }
-    });
+    const update = {
+      deviceId,
+      temperatureC: temperature,
+      humidity: humidity ?? null,
+      timestamp: Date.now(),
+      trace,
+    };
+    this.batcher.enqueue(deviceRoom(deviceId), update);
+    // The batcher keeps one value per device, so a client in several of
+    // these rooms still receives the update once
+    for (const locationId of this.locationFanout.locationsOf(deviceId)) {
+      this.batcher.enqueue(locationRoom(locationId), update);
+    }
 
     this.logger.debug(
-      `Broadcasted temperature update for device ${deviceId}: ${temperature}°C${humidity !== undefined ? `, ${humidity}%` : ''}`,
+      `Queued temperature update for device ${deviceId}: ${temperature}°C${humidity !== undefined ? `, ${humidity}%` : ''}`,
     );
   }
 
@@ -442,18 +658,10 @@ export class WebsocketGateway
   }
 
   broadcastHumidityUpdate(deviceId: string, humidity: number) {
-    const clients = Array.from(
-      this.server.sockets.sockets.values(),
-    ) as AuthenticatedSocket[];
-
-    clients.forEach((client) => {
-      if (client.data.subscribedDevices?.has(deviceId)) {
-        client.emit('data:humidity', {
-          deviceId,
-          humidity,
-          timestamp: new Date().toISOString(),
-        });
-      }
+    this.server.to(deviceRoom(deviceId)).emit('data:humidity', {
+      deviceId,
+      humidity,
+      timestamp: new Date().toISOString(),
     });
 
     this.logger.debug(
@@ -461,6 +669,119 @@ export class WebsocketGateway
     );
   }
 
+  // Devices a client follows directly or through a location
+  private followedDevices(client: AuthenticatedSocket): Set<string> {
+    const followed = new Set(client.data.subscribedDevices);
+    for (const locationId of client.data.subscribedLocations ?? []) {
+      this.locationFanout
+        .membersOf(locationId)
+        .forEach((deviceId) => followed.add(deviceId));
+    }
+    return followed;
+  }
+
+  // Drops pending values for devices the client stopped following
+  private prune(client: AuthenticatedSocket) {
+    const pending = client.data.telemetry?.pending;
+    if (!pending) return;
+    const followed = this.followedDevices(client);
+    this.batcher.discard(
+      client,
+      Array.from(pending.keys()).filter((id) => !followed.has(id)),
+    );
+  }
+
+  private reindex(client: AuthenticatedSocket) {
+    const telemetry = client.data.telemetry;
+    if (!telemetry?.binary) return;
+
+    // New epoch: frames still in flight for the old index get ignored
+    const deviceIds = Array.from(this.followedDevices(client));
+    telemetry.epoch = (telemetry.epoch + 1) & 0xffff;
+    telemetry.deviceIndex = new Map(deviceIds.map((id, i) => [id, i]));
+    telemetry.pending.clear();
+    // Frames cannot address that many devices, so the batcher falls back
+    // to telemetry:batch until the client follows fewer
+    if (deviceIds.length > MAX_FRAME_DEVICES) return;
+    client.emit('telemetry:index', { epoch: telemetry.epoch, deviceIds });
+  }
+
+  private socketsIn(room: string): AuthenticatedSocket[] {
+    const ids = this.server.sockets.adapter.rooms.get(room) ?? new Set();
+    return Array.from(ids)
+      .map((id) => this.server.sockets.sockets.get(id))
+      .filter((socket) => socket !== undefined) as AuthenticatedSocket[];
+  }
+
+  // Device moves and location edits often come in bursts
+  private scheduleMembershipRefresh() {
+    this.membershipTimer ??= setTimeout(() => {
+      this.membershipTimer = null;
+      void this.refreshMembership();
+    }, 250);
+  }
+
+  private async refreshMembership() {
+    const watched = this.locationFanout.watched();
+    if (watched.length === 0) return;
+
+    try {
+      const subtrees = await this.locationRollupService.getSubtrees(watched);
+      for (const locationId of watched) {
+        const room = locationRoom(locationId);
+        const subtree = subtrees.get(locationId);
+        if (!subtree) {
+          // The location was deleted
+          this.locationFanout.remove(locationId);
+          this.server.to(room).emit('location:removed', { locationId });
+          this.server.in(room).socketsLeave(room);
+          continue;
+        }
+        if (!this.locationFanout.set(locationId, subtree.deviceIds)) continue;
+
+        this.server.to(room).emit('location:members', {
+          locationId,
+          deviceIds: subtree.deviceIds,
+        });
+        this.socketsIn(room).forEach((client) => {
+          this.prune(client);
+          this.reindex(client);
+        });
+      }
+    } catch (error) {
+      const errorMessage =
+        error instanceof Error ? error.message : 'Unknown error';
+      this.logger.error(`Error refreshing location members: ${errorMessage}`);
+    }
+  }
+
+  // One frame per watched location, shared by everyone in its room
+  private async emitLocationStats() {
+    const rooms = this.server.sockets.adapter.rooms;
+    const watched = this.locationFanout.watched().filter((locationId) => {
+      if (rooms.has(locationRoom(locationId))) return true;
+      // The last watcher left; drop the group
+      this.locationFanout.remove(locationId);
+      this.lastLocationStats.delete(locationId);
+      return false;
+    });
+    if (watched.length === 0) return;
+
+    try {
+      const subtrees = await this.locationRollupService.getSubtrees(watched);
+      for (const [locationId, { stats }] of subtrees) {
+        const serialized = JSON.stringify(stats);
+        if (this.lastLocationStats.get(locationId) === serialized) continue;
+        this.lastLocationStats.set(locationId, serialized);
+        this.server.to(locationRoom(locationId)).emit('location:stats', stats);
+      }
+    } catch (error) {
+      const errorMessage =
+        error instanceof Error ? error.message : 'Unknown error';
+      this.logger.error(`Error emitting location stats: ${errorMessage}`);
+    }
+  }
+
   private extractToken(client: AuthenticatedSocket): string | null {
     const token = client.handshake.auth?.token;
     if (token) return token;
@@ -0,0 +1,213 @@
+/**
+ * Times the hot query paths against a database seeded with
+ * `npm run db:seed-synthetic` and compares them with a stored baseline.
+ *
+ *   npm run bench:queries -- [--iterations 30] [--threshold 0.2]
+ *     [--update-baseline]
+ *
+ * A case regresses when its p50 or p99 exceeds the baseline by more than
+ * --threshold (a fraction) and by more than --min-delta-ms, which keeps
+ * sub-millisecond noise from failing the run. Any regression exits with 1.
+ */
+import { existsSync, readFileSync, writeFileSync } from 'fs';
+import { join } from 'path';
+import { performance } from 'perf_hooks';
+import { parseArgs } from 'util';
+import { ConfigService } from '@nestjs/config';
+import { and, asc, eq, isNull, like } from 'drizzle-orm';
+import { DbClient } from '../../src/db/client';
+import { devices, locations } from '../../src/db/schema';
+import { MetricsService } from '../../src/metrics/metrics.service';
+import { ClusterService } from '../../src/cluster/cluster.service';
+import { TemperatureService } from '../../src/temperature/temperature.service';
+import {
+  DeviceSnapshotService,
+} from '../../src/devices/device-snapshot.service';
+import { DevicesService } from '../../src/devices/devices.service';
+
+const BASELINE_PATH = join(__dirname, 'baseline.json');
+const HOUR_MS = 60 * 60 * 1000;
+
+interface Result {
+  p50: number;
+  p99: number;
+}
+
+type Baseline = Record<string, Result>;
+
+const { values } = parseArgs({
+  options: {
+    iterations: { type: 'string', default: '30' },
+    warmup: { type: 'string', default: '3' },
+    threshold: { type: 'string', default: '0.2' },
+    'min-delta-ms': { type: 'string', default: '2' },
+    'update-baseline': { type: 'boolean', default: false },
+  },
+});
+
+async function main() {
+  const configService = new ConfigService({
+    DATABASE_URL: process.env.DATABASE_URL,
+  });
+  const metricsService = new MetricsService();
+  const dbClient = new DbClient(configService, metricsService);
+  dbClient.onModuleInit();
+  // Never started, so it stays a single-instance no-op
+  const clusterService = new ClusterService(
+    configService,
+    dbClient,
+    metricsService,
+  );
+
+  const temperatureService = new TemperatureService(dbClient, configService);
+  const snapshotService = new DeviceSnapshotService(dbClient, clusterService);
+  const devicesService = new DevicesService(
+    dbClient,
+    snapshotService,
+    configService,
+    clusterService,
+  );
+
+  // Benchmark against the synthetic fleet, not whatever else is in the db
+  const [device] = await dbClient.db
+    .select({ id: devices.id, ownerId: devices.ownerId })
+    .from(devices)
+    .where(like(devices.id, 'synthetic-%'))
+    .orderBy(asc(devices.id))
+    .limit(1);
+  if (!device?.ownerId) {
+    throw new Error('No synthetic devices; run npm run db:seed-synthetic');
+  }
+  const [building] = await dbClient.db
+    .select({ id: locations.id })
+    .from(locations)
+    .where(
+      and(
+        eq(locations.ownerId, device.ownerId),
+        eq(locations.description, 'synthetic'),
+        isNull(locations.parentId),
+      ),
+    )
+    .limit(1);
+  if (!building) throw new Error('No synthetic location hierarchy');
+
+  const now = new Date();
+  const ago = (hours: number) => new Date(now.getTime() - hours * HOUR_MS);
+
+  const cases: Record<string, () => Promise<unknown>> = {
+    'latest-per-device': () =>
+      temperatureService.getLatestByDevice(device.id),
+    'history-24h-page': () =>
+      temperatureService.getReadingsPage(
+        device.id,
+        ago(24),
+        now,
+        undefined,
+        1000,
+      ),
+    'history-30d-downsampled': () =>
+      temperatureService.getHistory(device.id, ago(30 * 24), now, 300),
+    'stats-all-devices-24h': () =>
+      temperatureService.getAllDevicesStats(ago(24), now),
+    'aggregates-1h-30d-page': () =>
+      temperatureService.getAggregatesPage(
+        device.id,
+        '1h',
+        ago(30 * 24),
+        now,
+        undefined,
+        1000,
+      ),
+    // Cold snapshot load, which is what devices:list pays after a change
+    'devices-list-cold': () => {
+      snapshotService.invalidate();
+      return snapshotService.getActive(device.ownerId!);
+    },
+    'location-descendants': () =>
+      devicesService.findAll(device.ownerId!, building.id),
+  };
+
+  const results: Baseline = {};
+  for (const [name, run] of Object.entries(cases)) {
+    const result = await measure(run);
+    results[name] = result;
+    console.log(
+      `${name.padEnd(26)}p50 ${ms(result.p50)}  p99 ${ms(result.p99)}`,
+    );
+  }
+
+  await dbClient.onModuleDestroy();
+
+  if (values['update-baseline']) {
+    writeFileSync(BASELINE_PATH, JSON.stringify(results, null, 2) + '\n');
+    console.log(`\nBaseline written to ${BASELINE_PATH}`);
+    return;
+  }
+
+  if (!existsSync(BASELINE_PATH)) {
+    console.log('\nNo baseline stored; rerun with --update-baseline');
+    return;
+  }
+
+  const regressions = compare(
+    JSON.parse(readFileSync(BASELINE_PATH, 'utf8')) as Baseline,
+    results,
+  );
+  if (regressions.length > 0) {
+    console.error('\nRegressions:');
+    regressions.forEach((line) => console.error(`  ${line}`));
+    process.exitCode = 1;
+  } else {
+    console.log('\nNo regressions against the baseline');
+  }
+}
+
+async function measure(run: () => Promise<unknown>): Promise<Result> {
+  for (let i = 0; i < Number(values.warmup); i++) await run();
+
+  const samples: number[] = [];
+  for (let i = 0; i < Number(values.iterations); i++) {
+    const start = performance.now();
+    await run();
+    samples.push(performance.now() - start);
+  }
+
+  samples.sort((a, b) => a - b);
+  return { p50: percentile(samples, 0.5), p99: percentile(samples, 0.99) };
+}
+
+// Nearest-rank percentile of sorted samples
+function percentile(sorted: number[], p: number): number {
+  const rank = Math.ceil(p * sorted.length) - 1;
+  return sorted[Math.min(Math.max(rank, 0), sorted.length - 1)];
+}
+
+function compare(baseline: Baseline, results: Baseline): string[] {
+  const threshold = Number(values.threshold);
+  const minDelta = Number(values['min-delta-ms']);
+  const regressions: string[] = [];
+
+  for (const [name, result] of Object.entries(results)) {
+    const base = baseline[name];
+    if (!base) continue;
+    for (const stat of ['p50', 'p99'] as const) {
+      const limit = Math.max(
+        base[stat] * (1 + threshold),
+        base[stat] + minDelta,
+      );
+      if (result[stat] > limit) {
+        regressions.push(
+          `${name} ${stat} ${ms(result[stat])} > ${ms(base[stat])} baseline`,
+        );
+      }
+    }
+  }
+  return regressions;
+}
+
+const ms = (value: number) => `${value.toFixed(2)} ms`.padStart(11);
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,133 @@
+/**
+ * Compares the generated telemetry decoder with the previous ingest path,
+ * `JSON.parse(payload.toString())` without validation, on firmware-shaped
+ * payloads. No database or broker is needed.
+ *
+ *   npm run bench:decode -- [--messages 1000] [--rounds 30]
+ *
+ * Each round decodes every message 100 times per decoder, alternating
+ * between them; the best round of each is reported to filter out noise.
+ *
+ * It then feeds the same messages through TelemetryDecodePool in bursts
+ * of --burst per event loop turn, as a busy broker connection delivers
+ * them, and reports the event loop time spent per message with none and
+ * with --workers (default 2) worker threads. Run it on a machine with a
+ * core to spare per worker; otherwise the workers compete with the main
+ * thread for CPU.
+ */
+import { randomUUID } from 'crypto';
+import { performance } from 'perf_hooks';
+import { parseArgs } from 'util';
+import { TelemetryDecodePool } from '../../src/ingest/telemetry-decode-pool';
+import { decodeTelemetry } from '../../src/ingest/telemetry.generated';
+
+const { values } = parseArgs({
+  options: {
+    messages: { type: 'string', default: '1000' },
+    rounds: { type: 'string', default: '30' },
+    workers: { type: 'string', default: '2' },
+    burst: { type: 'string', default: '100' },
+  },
+});
+
+const REPEAT = 100;
+
+function payloads(count: number): Buffer[] {
+  return Array.from({ length: count }, (_, i) => {
+    const mac = (i % 256).toString(16).padStart(2, '0').toUpperCase();
+    return Buffer.from(
+      JSON.stringify({
+        deviceId: `24:6F:28:AA:BB:${mac}`,
+        temperature: Math.round((15 + Math.random() * 15) * 100) / 100,
+        humidity: Math.round(Math.random() * 10_000) / 100,
+        timestamp: Date.now() + i * 1000,
+      }),
+    );
+  });
+}
+
+const decoders: Record<string, (payload: Buffer) => unknown> = {
+  'JSON.parse': (payload) => {
+    try {
+      return JSON.parse(payload.toString()) as unknown;
+    } catch {
+      return null;
+    }
+  },
+  decodeTelemetry: (payload) => {
+    const result = decodeTelemetry(payload);
+    return result.ok ? result.message : null;
+  },
+};
+
+// Event loop time per message, best of three passes over `messages`
+async function poolRound(workers: number, messages: Buffer[]) {
+  const pool = new TelemetryDecodePool({ workers, minBatch: 8, maxBatch: 256 });
+  const burst = Number(values.burst);
+  let best = Infinity;
+
+  for (let pass = 0; pass < 3; pass++) {
+    const start = performance.eventLoopUtilization();
+    const pending: Promise<unknown>[] = [];
+    for (let r = 0; r < REPEAT; r++) {
+      for (let i = 0; i < messages.length; i += burst) {
+        for (const payload of messages.slice(i, i + burst)) {
+          pending.push(pool.decode(payload, Date.now(), randomUUID()));
+        }
+        await new Promise((resolve) => setImmediate(resolve));
+      }
+    }
+    await Promise.all(pending);
+    const { active } = performance.eventLoopUtilization(start);
+    best = Math.min(best, (active * 1e6) / (REPEAT * messages.length));
+  }
+
+  await pool.close();
+  return best;
+}
+
+async function main() {
+  const messages = payloads(Number(values.messages));
+  const best = Object.fromEntries(
+    Object.keys(decoders).map((name) => [name, Infinity]),
+  );
+  let decoded = 0;
+
+  for (let round = 0; round < Number(values.rounds); round++) {
+    for (const [name, decode] of Object.entries(decoders)) {
+      const startedAt = performance.now();
+      for (let r = 0; r < REPEAT; r++) {
+        for (const payload of messages) {
+          if (decode(payload) !== null) decoded++;
+        }
+      }
+      const nsPerMessage =
+        ((performance.now() - startedAt) * 1e6) / (REPEAT * messages.length);
+      best[name] = Math.min(best[name], nsPerMessage);
+    }
+  }
+
+  const baseline = best['JSON.parse'];
+  for (const [name, ns] of Object.entries(best)) {
+    console.log(
+      `${name.padEnd(16)} ${ns.toFixed(0).padStart(6)} ns/msg ` +
+        `${(1000 / ns).toFixed(2)} M msg/s ` +
+        `(${(baseline / ns).toFixed(2)}x)`,
+    );
+  }
+  // Keeps the decoded results observable so nothing is optimized away
+  if (decoded === 0) throw new Error('Nothing decoded');
+
+  for (const workers of [0, Number(values.workers)]) {
+    const ns = await poolRound(workers, messages);
+    console.log(
+      `TelemetryDecodePool, ${workers} workers: ` +
+        `${ns.toFixed(0)} ns/msg on the event loop`,
+    );
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,240 @@
+/**
+ * WebSocket fan-out load test. Opens many Socket.IO clients, each
+ * subscribed to a random set of devices, while publishing telemetry for
+ * those devices over MQTT, then reports delivery latency and what the
+ * backend spent on it.
+ *
+ * The backend must run with AUTH_STUB=true; clients authenticate with
+ * `stub:<id>` tokens instead of Supabase sessions.
+ *
+ *   npm run load:ws -- --clients 2000 --devices 200 --per-client 10
+ *     --rate 500 --duration 60 [--url http://localhost:3000]
+ *     [--broker mqtt://localhost:1883] [--device-prefix synthetic-]
+ *
+ * Latency is measured two ways, both on this machine's clock:
+ * publish_to_client covers ingest, persistence and fan-out;
+ * broadcast_to_client starts when the gateway queued the update.
+ */
+import { parseArgs } from 'util';
+import { setTimeout as sleep } from 'timers/promises';
+import { io, Socket } from 'socket.io-client';
+import { TELEMETRY_TOPIC, connectBroker } from '../../tools/lib/broker';
+import { Samples, delta, scrapeMetrics, series } from '../../tools/lib/metrics';
+
+interface TelemetryUpdate {
+  deviceId: string;
+  temperatureC: number;
+  timestamp: number;
+}
+
+const { values } = parseArgs({
+  options: {
+    url: { type: 'string', default: 'http://localhost:3000' },
+    broker: { type: 'string' },
+    clients: { type: 'string', default: '1000' },
+    devices: { type: 'string', default: '100' },
+    'device-prefix': { type: 'string', default: 'synthetic-' },
+    'per-client': { type: 'string', default: '10' },
+    // Messages per second across all devices
+    rate: { type: 'string', default: '200' },
+    duration: { type: 'string', default: '60' },
+    // Clients connected per second while ramping up
+    ramp: { type: 'string', default: '200' },
+  },
+});
+
+/** Millisecond-resolution histogram; exact enough for latency reports. */
+class LatencyHistogram {
+  private readonly counts = new Uint32Array(60_001);
+  count = 0;
+
+  record(ms: number) {
+    const index = Math.min(Math.max(Math.round(ms), 0), 60_000);
+    this.counts[index]++;
+    this.count++;
+  }
+
+  percentile(p: number): number {
+    const rank = Math.ceil(p * this.count);
+    let seen = 0;
+    for (let ms = 0; ms < this.counts.length; ms++) {
+      seen += this.counts[ms];
+      if (seen >= rank) return ms;
+    }
+    return 60_000;
+  }
+}
+
+async function main() {
+  const clientCount = Number(values.clients);
+  const perClient = Number(values['per-client']);
+  const deviceIds = Array.from(
+    { length: Number(values.devices) },
+    (_, i) => `${values['device-prefix']}${String(i + 1).padStart(6, '0')}`,
+  );
+  const metricsUrl = `${values.url}/metrics`;
+
+  // deviceId:temperature -> publish time; values are unique per device
+  // within a window, so each delivered update maps back to its publish
+  const published = new Map<string, number>();
+  const publishToClient = new LatencyHistogram();
+  const broadcastToClient = new LatencyHistogram();
+  let updatesReceived = 0;
+  let measuring = false;
+
+  const idle = await scrapeMetrics(metricsUrl);
+
+  console.log(`Connecting ${clientCount} clients`);
+  const sockets: Socket[] = [];
+  const rampDelay = 1000 / Number(values.ramp);
+  for (let i = 0; i < clientCount; i++) {
+    const socket = io(values.url, {
+      auth: { token: `stub:00000000-0000-4000-8000-${pad(i, 12)}` },
+      transports: ['websocket'],
+    });
+    socket.on('authenticated', () =>
+      socket.emit('devices:subscribe', {
+        deviceIds: sample(deviceIds, perClient),
+      }),
+    );
+    socket.on('telemetry:batch', (updates: TelemetryUpdate[]) => {
+      if (!measuring) return;
+      const now = Date.now();
+      for (const update of updates) {
+        updatesReceived++;
+        broadcastToClient.record(now - update.timestamp);
+        const at = published.get(`${update.deviceId}:${update.temperatureC}`);
+        if (at !== undefined) publishToClient.record(now - at);
+      }
+    });
+    sockets.push(socket);
+    await sleep(rampDelay);
+  }
+
+  await sleep(2000);
+  const connected = sockets.filter((socket) => socket.connected).length;
+  const loaded = await scrapeMetrics(metricsUrl);
+  console.log(`${connected}/${clientCount} clients connected`);
+
+  console.log(
+    `Publishing ${values.rate} msg/s for ${values.duration} s over ` +
+      `${deviceIds.length} devices`,
+  );
+  const broker = await connectBroker(values.broker);
+  const sequence = new Map<string, number>();
+  const intervalMs = 1000 / Number(values.rate);
+  const endAt = Date.now() + Number(values.duration) * 1000;
+  let sent = 0;
+  measuring = true;
+  const started = Date.now();
+
+  while (Date.now() < endAt) {
+    const deviceId = deviceIds[sent % deviceIds.length];
+    const seq = (sequence.get(deviceId) ?? 0) + 1;
+    sequence.set(deviceId, seq);
+    const temperatureC = Number((15 + (seq % 2000) / 100).toFixed(2));
+    const now = Date.now();
+    published.set(`${deviceId}:${temperatureC}`, now);
+
+    void broker.publishAsync(
+      TELEMETRY_TOPIC,
+      JSON.stringify({ deviceId, temperature: temperatureC, timestamp: now }),
+    );
+    sent++;
+
+    const due = started + sent * intervalMs;
+    if (due > Date.now()) await sleep(due - Date.now());
+  }
+
+  // Let the last frames arrive
+  await sleep(3000);
+  measuring = false;
+  const finished = await scrapeMetrics(metricsUrl);
+
+  await broker.endAsync();
+  sockets.forEach((socket) => socket.disconnect());
+
+  report({
+    connected,
+    sent,
+    updatesReceived,
+    publishToClient,
+    broadcastToClient,
+    idle,
+    loaded,
+    finished,
+  });
+}
+
+function report(run: {
+  connected: number;
+  sent: number;
+  updatesReceived: number;
+  publishToClient: LatencyHistogram;
+  broadcastToClient: LatencyHistogram;
+  idle: Samples;
+  loaded: Samples;
+  finished: Samples;
+}) {
+  const { idle, loaded, finished } = run;
+  const processed = delta(
+    loaded,
+    finished,
+    series('heatsync_ingest_messages_total', { outcome: 'processed' }),
+  );
+  const frames = ['json', 'binary'].reduce(
+    (sum, format) =>
+      sum +
+      delta(loaded, finished, series('heatsync_ws_frames_total', { format })),
+    0,
+  );
+  const cpuSeconds = delta(loaded, finished, 'process_cpu_seconds_total');
+  const rssPerClient =
+    delta(idle, loaded, 'process_resident_memory_bytes') / run.connected;
+  const heapPerClient =
+    delta(idle, loaded, 'nodejs_heap_used_bytes') / run.connected;
+
+  console.log('');
+  console.log(`clients              ${run.connected}`);
+  console.log(`published            ${run.sent}`);
+  console.log(`processed            ${processed}`);
+  console.log(`frames emitted       ${frames}`);
+  console.log(`updates received     ${run.updatesReceived}`);
+  for (const [name, histogram] of [
+    ['publish_to_client', run.publishToClient],
+    ['broadcast_to_client', run.broadcastToClient],
+  ] as const) {
+    console.log(
+      `${name.padEnd(21)}p50 ${histogram.percentile(0.5)} ms  ` +
+        `p90 ${histogram.percentile(0.9)} ms  ` +
+        `p99 ${histogram.percentile(0.99)} ms  ` +
+        `max ${histogram.percentile(1)} ms`,
+    );
+  }
+  console.log(
+    `cpu per message      ${perUnit(cpuSeconds * 1000, processed)} ms`,
+  );
+  console.log(`cpu per frame        ${perUnit(cpuSeconds * 1e6, frames)} µs`);
+  console.log(`rss per connection   ${(rssPerClient / 1024).toFixed(1)} KiB`);
+  console.log(`heap per connection  ${(heapPerClient / 1024).toFixed(1)} KiB`);
+}
+
+const perUnit = (total: number, count: number) =>
+  count > 0 ? (total / count).toFixed(3) : '-';
+
+const pad = (value: number, length: number) =>
+  String(value).padStart(length, '0');
+
+function sample<T>(items: T[], count: number): T[] {
+  const pool = [...items];
+  for (let i = pool.length - 1; i > 0; i--) {
+    const j = Math.floor(Math.random() * (i + 1));
+    [pool[i], pool[j]] = [pool[j], pool[i]];
+  }
+  return pool.slice(0, count);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
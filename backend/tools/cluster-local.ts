@@ -0,0 +1,62 @@
+/**
+ * Runs several backend processes against the same broker and database to
+ * exercise cluster mode locally. Build first; each process runs dist/main.
+ *
+ *   npm run cluster:local -- --ingest 2 --dashboard 2 [--base-port 3000]
+ *
+ * Ingest instances get ports from --base-port, dashboard instances follow.
+ * Each process has its own WAL directory and prefixes its output with its
+ * name. Ctrl-C stops them all.
+ */
+import { ChildProcess, spawn } from 'child_process';
+import { createInterface } from 'readline';
+import { parseArgs } from 'util';
+
+function main() {
+  const { values } = parseArgs({
+    options: {
+      ingest: { type: 'string', default: '2' },
+      dashboard: { type: 'string', default: '2' },
+      'base-port': { type: 'string', default: '3000' },
+    },
+  });
+
+  const roles = [
+    ...Array<string>(Number(values.ingest)).fill('ingest'),
+    ...Array<string>(Number(values.dashboard)).fill('dashboard'),
+  ];
+  if (roles.length === 0) throw new Error('Nothing to start');
+
+  const counts: Record<string, number> = {};
+  const children: ChildProcess[] = roles.map((role, index) => {
+    counts[role] = (counts[role] ?? 0) + 1;
+    const name = `${role}-${counts[role]}`;
+    const port = Number(values['base-port']) + index;
+
+    const child = spawn(process.execPath, ['dist/main'], {
+      env: {
+        ...process.env,
+        CLUSTER_MODE: 'true',
+        INSTANCE_ROLE: role,
+        PORT: String(port),
+        INGEST_WAL_DIR: `ingest-wal-${name}`,
+      },
+      stdio: ['ignore', 'pipe', 'pipe'],
+    });
+    for (const stream of [child.stdout!, child.stderr!]) {
+      createInterface({ input: stream }).on('line', (line) =>
+        console.log(`[${name}] ${line}`),
+      );
+    }
+    child.on('exit', (code) => console.log(`[${name}] exited with ${code}`));
+
+    console.log(`Started ${name} on port ${port}`);
+    return child;
+  });
+
+  process.on('SIGINT', () => {
+    children.forEach((child) => child.kill('SIGTERM'));
+  });
+}
+
+main();
@@ -0,0 +1,288 @@
+/**
+ * Generates the telemetry decoder and the firmware limits from the shared
+ * schema, so the backend and devices agree on one payload definition.
+ *
+ *   npm run codegen:telemetry
+ *
+ * Reads schema/telemetry.schema.json and writes
+ * src/ingest/telemetry.generated.ts and
+ * firmware/include/telemetry_schema.h. Only the JSON Schema subset the
+ * payload needs is supported: a flat object of string, number and
+ * integer properties with length and range limits. The decoder is run
+ * through Prettier, so its source here only needs to be valid.
+ */
+import { readFileSync, writeFileSync } from 'fs';
+import { join } from 'path';
+import { format, resolveConfig } from 'prettier';
+
+const ROOT = join(__dirname, '..', '..');
+const SCHEMA_PATH = join(ROOT, 'schema', 'telemetry.schema.json');
+const DECODER_PATH = join(
+  ROOT,
+  'backend',
+  'src',
+  'ingest',
+  'telemetry.generated.ts',
+);
+const HEADER_PATH = join(ROOT, 'firmware', 'include', 'telemetry_schema.h');
+
+interface PropertySchema {
+  type: 'string' | 'number' | 'integer';
+  description?: string;
+  minLength?: number;
+  maxLength?: number;
+  minimum?: number;
+  maximum?: number;
+}
+
+interface TelemetrySchema {
+  title: string;
+  type: 'object';
+  'x-mqtt-topic': string;
+  'x-device-id': string;
+  properties: Record<string, PropertySchema>;
+  required?: string[];
+}
+
+interface Field extends PropertySchema {
+  name: string;
+  required: boolean;
+}
+
+const SUPPORTED = new Set([
+  'type',
+  'description',
+  'minLength',
+  'maxLength',
+  'minimum',
+  'maximum',
+]);
+
+function load(): { schema: TelemetrySchema; fields: Field[] } {
+  const schema = JSON.parse(
+    readFileSync(SCHEMA_PATH, 'utf8'),
+  ) as TelemetrySchema;
+  if (schema.type !== 'object') throw new Error('Schema must be an object');
+
+  const required = new Set(schema.required ?? []);
+  const fields = Object.entries(schema.properties).map(([name, property]) => {
+    if (!['string', 'number', 'integer'].includes(property.type)) {
+      throw new Error(`${name}: unsupported type ${property.type}`);
+    }
+    for (const keyword of Object.keys(property)) {
+      if (!SUPPORTED.has(keyword)) {
+        throw new Error(`${name}: unsupported keyword ${keyword}`);
+      }
+    }
+    return { ...property, name, required: required.has(name) };
+  });
+
+  const sender = fields.find((field) => field.name === schema['x-device-id']);
+  if (sender?.type !== 'string') {
+    throw new Error('x-device-id must name a string property');
+  }
+  return { schema, fields };
+}
+
+// Conditions under which a present value breaks its limits
+function violations(field: Field): string[] {
+  const value = field.name;
+  if (field.type === 'string') {
+    return [
+      ...(field.minLength !== undefined
+        ? [`${value}.length < ${field.minLength}`]
+        : []),
+      ...(field.maxLength !== undefined
+        ? [`${value}.length > ${field.maxLength}`]
+        : []),
+    ];
+  }
+  return [
+    `!Number.isFinite(${value})`,
+    ...(field.minimum !== undefined ? [`${value} < ${field.minimum}`] : []),
+    ...(field.maximum !== undefined ? [`${value} > ${field.maximum}`] : []),
+  ];
+}
+
+function decoder(schema: TelemetrySchema, fields: Field[]): string {
+  const sender = fields.find((field) => field.name === schema['x-device-id'])!;
+  const senderChecks = violations(sender);
+  const lines: string[] = [];
+  const out = (line = '') => lines.push(line);
+
+  out('// Generated from schema/telemetry.schema.json by');
+  out('// tools/gen-telemetry-schema.ts. Do not edit; run');
+  out('// `npm run codegen:telemetry` instead.');
+  out("import { END_OF_OBJECT, JsonScanner } from './json-scanner';");
+  out();
+  out(`export const TELEMETRY_TOPIC = '${schema['x-mqtt-topic']}';`);
+  out();
+  out(`export interface ${schema.title} {`);
+  for (const field of fields) {
+    if (field.description) out(`  // ${field.description}`);
+    const type = field.type === 'string' ? 'string' : 'number';
+    out(`  ${field.name}${field.required ? '' : '?'}: ${type};`);
+  }
+  out('}');
+  out();
+  out('export type TelemetryRejection =');
+  out("  | 'malformed'");
+  out("  | 'missing_field'");
+  out("  | 'wrong_type'");
+  out("  | 'out_of_range';");
+  out();
+  out('export type TelemetryDecodeResult =');
+  out(`  | { ok: true; message: ${schema.title} }`);
+  out('  | {');
+  out('      ok: false;');
+  out('      reason: TelemetryRejection;');
+  out('      field: string | null;');
+  out('      // The sender, when its id could be read and is valid');
+  out('      deviceId: string | null;');
+  out('    };');
+  out();
+  out('const KEYS = [');
+  for (const field of fields) out(`  Buffer.from('${field.name}'),`);
+  out('];');
+  out();
+  out('const scanner = new JsonScanner();');
+  out();
+  out('const reject = (');
+  out('  reason: TelemetryRejection,');
+  out('  field: string | null,');
+  out('  deviceId: string | null,');
+  out('): TelemetryDecodeResult => ({ ok: false, reason, field, deviceId });');
+  out();
+  out('/**');
+  out(` * Decodes and validates a ${schema.title} straight from the MQTT`);
+  out(' * payload. Unknown keys are skipped; anything JSON.parse would reject');
+  out(' * is malformed.');
+  out(' */');
+  out(
+    'export function decodeTelemetry(payload: Buffer): TelemetryDecodeResult {',
+  );
+  for (const field of fields) {
+    const type = field.type === 'string' ? 'string' : 'number';
+    out(`  let ${field.name}: ${type} | undefined;`);
+  }
+  out('  let wrongType: string | null = null;');
+  out();
+  out('  scanner.reset(payload);');
+  out('  if (scanner.begin()) {');
+  out('    for (;;) {');
+  out('      const key = scanner.nextKey(KEYS);');
+  out('      if (key === END_OF_OBJECT) break;');
+  out('      switch (key) {');
+  fields.forEach((field, index) => {
+    const kind = field.type === 'string' ? 'string' : 'number';
+    const read = field.type === 'string' ? 'readString' : 'readNumber';
+    out(`        case ${index}:`);
+    out(`          if (scanner.valueType() === '${kind}') {`);
+    out(`            ${field.name} = scanner.${read}();`);
+    out('          } else {');
+    out(`            wrongType ??= '${field.name}';`);
+    out('            scanner.skipValue();');
+    out('          }');
+    out('          break;');
+  });
+  out('        default:');
+  out('          scanner.skipValue();');
+  out('      }');
+  out('    }');
+  out('  }');
+  out();
+  const invalidSender = [`${sender.name} === undefined`, ...senderChecks];
+  out(
+    `  const sender = ${invalidSender.join(' || ')} ? null : ${sender.name};`,
+  );
+  out("  if (!scanner.end()) return reject('malformed', null, sender);");
+  out("  if (wrongType) return reject('wrong_type', wrongType, sender);");
+  for (const field of fields) {
+    const name = field.name;
+    const presence = field.required ? '' : `${name} !== undefined && `;
+    if (field.required) {
+      out(`  if (${name} === undefined) {`);
+      out(`    return reject('missing_field', '${name}', sender);`);
+      out('  }');
+    }
+    if (field.type === 'integer') {
+      out(`  if (${presence}!Number.isInteger(${name})) {`);
+      out(`    return reject('wrong_type', '${name}', sender);`);
+      out('  }');
+    }
+    const checks = violations(field);
+    if (checks.length === 0) continue;
+    const condition = checks.join(' || ');
+    out(`  if (${presence}(${condition})) {`);
+    out(`    return reject('out_of_range', '${name}', sender);`);
+    out('  }');
+  }
+  out();
+  out('  return {');
+  out('    ok: true,');
+  out(`    message: { ${fields.map((field) => field.name).join(', ')} },`);
+  out('  };');
+  out('}');
+  return lines.join('\n') + '\n';
+}
+
+const macro = (name: string) =>
+  name.replace(/([a-z0-9])([A-Z])/g, '$1_$2').toUpperCase();
+
+function cNumber(value: number, type: Field['type']): string {
+  const literal =
+    type === 'integer'
+      ? String(value)
+      : `${Number.isInteger(value) ? value.toFixed(1) : value}f`;
+  return value < 0 ? `(${literal})` : literal;
+}
+
+function header(schema: TelemetrySchema, fields: Field[]): string {
+  const lines = [
+    '// Generated from schema/telemetry.schema.json by',
+    '// backend/tools/gen-telemetry-schema.ts. Do not edit; run',
+    '// `npm run codegen:telemetry` in backend/ instead.',
+    '#pragma once',
+    '',
+    `#define TELEMETRY_TOPIC "${schema['x-mqtt-topic']}"`,
+  ];
+  for (const field of fields) {
+    const prefix = `TELEMETRY_${macro(field.name)}`;
+    lines.push('');
+    if (field.description) lines.push(`// ${field.description}`);
+    lines.push(`#define ${prefix}_KEY "${field.name}"`);
+    if (field.minLength !== undefined) {
+      lines.push(`#define ${prefix}_MIN_LENGTH ${field.minLength}`);
+    }
+    if (field.maxLength !== undefined) {
+      lines.push(`#define ${prefix}_MAX_LENGTH ${field.maxLength}`);
+    }
+    if (field.minimum !== undefined) {
+      lines.push(`#define ${prefix}_MIN ${cNumber(field.minimum, field.type)}`);
+    }
+    if (field.maximum !== undefined) {
+      lines.push(`#define ${prefix}_MAX ${cNumber(field.maximum, field.type)}`);
+    }
+  }
+  return lines.join('\n') + '\n';
+}
+
+async function main() {
+  const { schema, fields } = load();
+  const config = await resolveConfig(DECODER_PATH);
+  writeFileSync(
+    DECODER_PATH,
+    await format(decoder(schema, fields), {
+      ...config,
+      filepath: DECODER_PATH,
+    }),
+  );
+  writeFileSync(HEADER_PATH, header(schema, fields));
+  console.log(`Wrote ${DECODER_PATH}`);
+  console.log(`Wrote ${HEADER_PATH}`);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
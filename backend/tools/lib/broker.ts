@@ -0,0 +1,22 @@
+import * as mqtt from 'mqtt';
+
+export const TELEMETRY_TOPIC = 'heatsync/telemetry';
+
+// Connects to `url` when given, otherwise to the broker the backend uses
+export async function connectBroker(url?: string): Promise<mqtt.MqttClient> {
+  const client = url
+    ? mqtt.connect(url)
+    : mqtt.connect({
+        host: process.env.MQTT_HOST,
+        port: Number(process.env.MQTT_PORT),
+        protocol: process.env.MQTT_PROTOCOL as 'mqtt' | 'mqtts',
+        username: process.env.MQTT_USERNAME,
+        password: process.env.MQTT_PASSWORD,
+      });
+
+  await new Promise<void>((resolve, reject) => {
+    client.once('connect', () => resolve());
+    client.once('error', reject);
+  });
+  return client;
+}
@@ -0,0 +1,10 @@
+import { drizzle } from 'drizzle-orm/node-postgres';
+import { Pool, PoolConfig } from 'pg';
+
+export function connectDb(config: PoolConfig = {}) {
+  const pool = new Pool({
+    connectionString: process.env.DATABASE_URL,
+    ...config,
+  });
+  return { pool, db: drizzle(pool) };
+}
@@ -0,0 +1,74 @@
+// Reads the backend's /metrics endpoint for benchmark reports
+
+export type Samples = Map<string, number>;
+
+export async function scrapeMetrics(
+  url: string,
+  token = process.env.METRICS_TOKEN,
+): Promise<Samples> {
+  const response = await fetch(url, {
+    headers: token ? { Authorization: `Bearer ${token}` } : {},
+  });
+  if (!response.ok) {
+    throw new Error(`GET ${url} failed with ${response.status}`);
+  }
+
+  const samples: Samples = new Map();
+  for (const line of (await response.text()).split('\n')) {
+    if (!line || line.startsWith('#')) continue;
+    const split = line.lastIndexOf(' ');
+    samples.set(line.slice(0, split), Number(line.slice(split + 1)));
+  }
+  return samples;
+}
+
+// Series key as rendered by the backend, e.g. name{a="1",b="2"}
+export function series(name: string, labels: Record<string, string> = {}) {
+  const pairs = Object.entries(labels).map(([k, v]) => `${k}="${v}"`);
+  return pairs.length > 0 ? `${name}{${pairs.join(',')}}` : name;
+}
+
+export function delta(before: Samples, after: Samples, key: string): number {
+  return (after.get(key) ?? 0) - (before.get(key) ?? 0);
+}
+
+/**
+ * Estimates a quantile of the observations made between two scrapes of a
+ * histogram, interpolating linearly inside the matching bucket like
+ * Prometheus' histogram_quantile. Returns seconds, or null if empty.
+ */
+export function histogramQuantile(
+  before: Samples,
+  after: Samples,
+  name: string,
+  labels: Record<string, string>,
+  quantile: number,
+): number | null {
+  const prefix = series(`${name}_bucket`, labels).replace(/}$/, '');
+  const buckets = [...after.keys()]
+    .filter((key) => key.startsWith(prefix))
+    .map((key) => ({
+      le: Number(/le="([^"]+)"/.exec(key)![1].replace('+Inf', 'Infinity')),
+      count: delta(before, after, key),
+    }))
+    .sort((a, b) => a.le - b.le);
+
+  const total = buckets.at(-1)?.count ?? 0;
+  if (total === 0) return null;
+
+  const rank = quantile * total;
+  let lower = 0;
+  let below = 0;
+  for (const bucket of buckets) {
+    if (bucket.count >= rank) {
+      if (!Number.isFinite(bucket.le)) return lower;
+      const inBucket = bucket.count - below;
+      return inBucket === 0
+        ? bucket.le
+        : lower + ((bucket.le - lower) * (rank - below)) / inBucket;
+    }
+    lower = bucket.le;
+    below = bucket.count;
+  }
+  return lower;
+}
@@ -0,0 +1,75 @@
+import { createReadStream, createWriteStream } from 'fs';
+import { once } from 'events';
+import { createGunzip, createGzip } from 'zlib';
+
+// File layout (gzipped): MAGIC, then one frame per message:
+// uint32 ms since the previous message, uint32 payload length, payload
+const MAGIC = Buffer.from('HSREC1\n');
+
+export interface RecordedMessage {
+  // Milliseconds since the first message of the recording
+  offsetMs: number;
+  payload: Buffer;
+}
+
+export class RecordingWriter {
+  private readonly gzip = createGzip();
+  private readonly done: Promise<unknown>;
+  private lastAt = 0;
+  count = 0;
+
+  constructor(path: string) {
+    const file = createWriteStream(path);
+    this.gzip.pipe(file);
+    this.done = once(file, 'finish');
+    this.gzip.write(MAGIC);
+  }
+
+  write(payload: Buffer, at = Date.now()): void {
+    this.lastAt ||= at;
+
+    const header = Buffer.alloc(8);
+    header.writeUInt32LE(Math.max(0, at - this.lastAt), 0);
+    header.writeUInt32LE(payload.length, 4);
+    this.gzip.write(header);
+    this.gzip.write(payload);
+
+    this.lastAt = at;
+    this.count++;
+  }
+
+  async close(): Promise<void> {
+    this.gzip.end();
+    await this.done;
+  }
+}
+
+export async function* readRecording(
+  path: string,
+): AsyncGenerator<RecordedMessage> {
+  let buffer = Buffer.alloc(0);
+  let offsetMs = 0;
+  let headerChecked = false;
+
+  for await (const chunk of createReadStream(path).pipe(createGunzip())) {
+    buffer = Buffer.concat([buffer, chunk as Buffer]);
+
+    if (!headerChecked) {
+      if (buffer.length < MAGIC.length) continue;
+      if (!buffer.subarray(0, MAGIC.length).equals(MAGIC)) {
+        throw new Error(`${path} is not a HeatSync recording`);
+      }
+      buffer = buffer.subarray(MAGIC.length);
+      headerChecked = true;
+    }
+
+    while (buffer.length >= 8) {
+      const length = buffer.readUInt32LE(4);
+      if (buffer.length < 8 + length) break;
+
+      offsetMs += buffer.readUInt32LE(0);
+      yield { offsetMs, payload: buffer.subarray(8, 8 + length) };
+      buffer = buffer.subarray(8 + length);
+    }
+  }
+}
@@ -0,0 +1,52 @@
+/**
+ * Records raw telemetry traffic with arrival times until interrupted.
+ *
+ *   npm run mqtt:record -- --out traffic.hsrec [--broker mqtt://host:1883]
+ *     [--duration 600]
+ */
+import { parseArgs } from 'util';
+import { RecordingWriter } from './lib/recording';
+import { TELEMETRY_TOPIC, connectBroker } from './lib/broker';
+
+async function main() {
+  const { values } = parseArgs({
+    options: {
+      out: { type: 'string', default: 'traffic.hsrec' },
+      broker: { type: 'string' },
+      topic: { type: 'string', default: TELEMETRY_TOPIC },
+      // Seconds; records until Ctrl+C when omitted
+      duration: { type: 'string' },
+    },
+  });
+
+  const writer = new RecordingWriter(values.out);
+  const client = await connectBroker(values.broker);
+
+  client.on('message', (topic, payload) => {
+    if (topic === values.topic) writer.write(payload);
+  });
+  await client.subscribeAsync(values.topic);
+  console.log(`Recording ${values.topic} to ${values.out}`);
+
+  const progress = setInterval(
+    () => console.log(`${writer.count} messages recorded`),
+    10_000,
+  );
+
+  await new Promise<void>((resolve) => {
+    process.once('SIGINT', resolve);
+    if (values.duration) {
+      setTimeout(resolve, Number(values.duration) * 1000);
+    }
+  });
+
+  clearInterval(progress);
+  await client.endAsync();
+  await writer.close();
+  console.log(`Wrote ${writer.count} messages to ${values.out}`);
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
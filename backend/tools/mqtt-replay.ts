@@ -0,0 +1,162 @@
+/**
+ * Replays a recording against a broker and reports how the backend kept up.
+ *
+ *   npm run mqtt:replay -- --in traffic.hsrec --speed 10
+ *     [--broker mqtt://localhost:1883]
+ *     [--metrics http://localhost:3000/metrics]
+ *
+ * --speed is a multiplier (1, 10, 100, ...) or "max" to publish as fast as
+ * the broker accepts. Device timestamps are shifted to the replay time so
+ * readings look live; --keep-timestamps sends them unchanged.
+ */
+import { parseArgs } from 'util';
+import { setTimeout as sleep } from 'timers/promises';
+import { readRecording } from './lib/recording';
+import { TELEMETRY_TOPIC, connectBroker } from './lib/broker';
+import {
+  Samples,
+  delta,
+  histogramQuantile,
+  scrapeMetrics,
+  series,
+} from './lib/metrics';
+
+const INGEST = 'heatsync_ingest_messages_total';
+const LATENCY = 'heatsync_telemetry_latency_seconds';
+// Outcomes that mean the backend is done with a message
+const SETTLED = ['processed', 'duplicate', 'parse_failure', 'shed', 'failed'];
+
+async function main() {
+  const { values } = parseArgs({
+    options: {
+      in: { type: 'string', default: 'traffic.hsrec' },
+      broker: { type: 'string' },
+      topic: { type: 'string', default: TELEMETRY_TOPIC },
+      speed: { type: 'string', default: '1' },
+      metrics: { type: 'string', default: 'http://localhost:3000/metrics' },
+      'keep-timestamps': { type: 'boolean', default: false },
+      // Seconds to wait for the backend to drain after the last publish
+      'drain-timeout': { type: 'string', default: '300' },
+    },
+  });
+
+  const speed = values.speed === 'max' ? Infinity : Number(values.speed);
+  if (!(speed > 0)) throw new Error('--speed must be a number or "max"');
+
+  const client = await connectBroker(values.broker);
+  const before = await scrapeMetrics(values.metrics);
+
+  console.log(`Replaying ${values.in} at ${values.speed}x`);
+  const startedAt = Date.now();
+  let published = 0;
+  let behindMs = 0;
+
+  for await (const { offsetMs, payload } of readRecording(values.in)) {
+    if (Number.isFinite(speed)) {
+      const due = startedAt + offsetMs / speed;
+      const wait = due - Date.now();
+      if (wait > 0) await sleep(wait);
+      else behindMs = Math.max(behindMs, -wait);
+    }
+
+    await client.publishAsync(
+      values.topic,
+      values['keep-timestamps'] ? payload : retime(payload),
+    );
+    published++;
+  }
+
+  const publishedAt = Date.now();
+  console.log(
+    `Published ${published} messages in ${seconds(publishedAt - startedAt)}` +
+      (behindMs > 0 ? ` (publisher fell up to ${behindMs} ms behind)` : ''),
+  );
+  await client.endAsync();
+
+  // Wait until the backend has settled everything that was published
+  const deadline = publishedAt + Number(values['drain-timeout']) * 1000;
+  let after: Samples;
+  do {
+    await sleep(250);
+    after = await scrapeMetrics(values.metrics);
+  } while (settled(before, after) < published && Date.now() < deadline);
+  const drainedAt = Date.now();
+
+  report({
+    published,
+    received: delta(before, after, received),
+    outcomes: Object.fromEntries(
+      SETTLED.map((outcome) => [
+        outcome,
+        delta(before, after, series(INGEST, { outcome })),
+      ]),
+    ),
+    throughput: settled(before, after) / ((drainedAt - startedAt) / 1000),
+    lagMs: drainedAt - publishedAt,
+    latency: Object.fromEntries(
+      ['device_to_ingest', 'ingest_to_commit', 'commit_to_emit'].map((hop) => [
+        hop,
+        {
+          p50: histogramQuantile(before, after, LATENCY, { hop }, 0.5),
+          p99: histogramQuantile(before, after, LATENCY, { hop }, 0.99),
+        },
+      ]),
+    ),
+  });
+}
+
+const received = series(INGEST, { outcome: 'received' });
+
+function settled(before: Samples, after: Samples) {
+  return SETTLED.reduce(
+    (sum, outcome) => sum + delta(before, after, series(INGEST, { outcome })),
+    0,
+  );
+}
+
+// Moves the device timestamp to now so the backend sees live readings
+function retime(payload: Buffer): Buffer {
+  try {
+    const message = JSON.parse(payload.toString()) as Record<string, unknown>;
+    if (typeof message.timestamp !== 'number') return payload;
+    return Buffer.from(JSON.stringify({ ...message, timestamp: Date.now() }));
+  } catch {
+    return payload;
+  }
+}
+
+function report(result: {
+  published: number;
+  received: number;
+  outcomes: Record<string, number>;
+  throughput: number;
+  lagMs: number;
+  latency: Record<string, { p50: number | null; p99: number | null }>;
+}) {
+  console.log('');
+  console.log(`published      ${result.published}`);
+  console.log(`received       ${result.received}`);
+  for (const [outcome, count] of Object.entries(result.outcomes)) {
+    console.log(`  ${outcome.padEnd(13)}${count}`);
+  }
+  console.log(`throughput     ${result.throughput.toFixed(1)} msg/s`);
+  console.log(`drain lag      ${seconds(result.lagMs)}`);
+  for (const [hop, { p50, p99 }] of Object.entries(result.latency)) {
+    console.log(`${hop.padEnd(17)}p50 ${millis(p50)}  p99 ${millis(p99)}`);
+  }
+  if (result.received < result.published) {
+    console.log(
+      `warning: ${result.published - result.received} messages never ` +
+        'reached the backend',
+    );
+  }
+}
+
+const seconds = (ms: number) => `${(ms / 1000).toFixed(1)} s`;
+const millis = (s: number | null) =>
+  s === null ? '-' : `${(s * 1000).toFixed(1)} ms`;
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -0,0 +1,281 @@
+/**
+ * Bulk-loads synthetic telemetry for query-performance testing: a location
+ * hierarchy, devices spread over its rooms, alert rules, years of readings
+ * and their aggregates. Everything generated is tagged so --reset can
+ * remove it again.
+ *
+ *   npm run db:seed-synthetic -- --owner <user uuid> --devices 200 --years 2
+ *     [--interval 60] [--buildings 2] [--chunk-days 14] [--reset]
+ *
+ * Readings are generated inside Postgres with generate_series, one chunk
+ * of days at a time, so nothing is streamed from this process.
+ */
+import { parseArgs } from 'util';
+import { SQL, like, eq, sql } from 'drizzle-orm';
+import {
+  alerts,
+  devices,
+  locationClosure,
+  locations,
+  temperatureAggregates,
+  temperatureReadings,
+} from '../src/db/schema';
+import { connectDb } from './lib/db';
+
+const DEVICE_PREFIX = 'synthetic-';
+// Stored in locations.description to find generated locations on reset
+const LOCATION_MARKER = 'synthetic';
+const DAY_MS = 24 * 60 * 60 * 1000;
+
+// Same bucket boundaries as TemperatureService.aggregateAndStore
+const BUCKETS: Record<string, string> = {
+  '1m': `date_trunc('minute', taken_at)`,
+  '5m': `timestamptz 'epoch' + floor(extract(epoch from taken_at) / 300) * 300 * interval '1 second'`,
+  '1h': `date_trunc('hour', taken_at)`,
+  '6h': `timestamptz 'epoch' + floor(extract(epoch from taken_at) / 21600) * 21600 * interval '1 second'`,
+  '1d': `date_trunc('day', taken_at)`,
+};
+
+const { values } = parseArgs({
+  options: {
+    owner: { type: 'string' },
+    devices: { type: 'string', default: '100' },
+    years: { type: 'string', default: '1' },
+    // Seconds between readings of one device
+    interval: { type: 'string', default: '60' },
+    buildings: { type: 'string', default: '2' },
+    sectors: { type: 'string', default: '3' },
+    floors: { type: 'string', default: '4' },
+    rooms: { type: 'string', default: '5' },
+    'chunk-days': { type: 'string', default: '14' },
+    'alert-email': { type: 'string', default: 'alerts@example.com' },
+    'skip-aggregates': { type: 'boolean', default: false },
+    reset: { type: 'boolean', default: false },
+  },
+});
+
+// Faster bulk load; a crash only loses the chunk being written
+const { pool, db } = connectDb({ options: '-c synchronous_commit=off' });
+
+async function main() {
+  if (values.reset) await reset();
+  if (!values.owner) {
+    if (values.reset) return;
+    throw new Error('--owner <user uuid> is required');
+  }
+
+  const deviceCount = Number(values.devices);
+  const intervalSeconds = Number(values.interval);
+  const chunkDays = Number(values['chunk-days']);
+  const end = new Date(Math.floor(Date.now() / DAY_MS) * DAY_MS);
+  const start = new Date(end.getTime() - Number(values.years) * 365 * DAY_MS);
+
+  const rooms = await createLocations(values.owner);
+  const deviceIds = await createDevices(values.owner, deviceCount, rooms, end);
+  await createAlerts(deviceIds);
+  console.log(
+    `Created ${rooms.length} rooms, ${deviceIds.length} devices and alerts`,
+  );
+
+  for (let from = start; from < end; ) {
+    const to = new Date(Math.min(from.getTime() + chunkDays * DAY_MS, +end));
+    const started = Date.now();
+
+    await insertReadings(deviceIds, from, to, intervalSeconds);
+    if (!values['skip-aggregates']) {
+      for (const [granularity, bucket] of Object.entries(BUCKETS)) {
+        await insertAggregates(granularity, bucket, from, to);
+      }
+    }
+
+    console.log(
+      `${from.toISOString().slice(0, 10)}..${to.toISOString().slice(0, 10)} ` +
+        `loaded in ${((Date.now() - started) / 1000).toFixed(1)} s`,
+    );
+    from = to;
+  }
+
+  console.log('Analyzing tables');
+  await db.execute(sql`ANALYZE temperature_readings`);
+  await db.execute(sql`ANALYZE temperature_aggregates`);
+  await db.execute(sql`ANALYZE devices`);
+  await db.execute(sql`ANALYZE locations`);
+  await db.execute(sql`ANALYZE location_closure`);
+}
+
+// Building -> sector -> floor -> room; returns the room ids
+async function createLocations(ownerId: string): Promise<number[]> {
+  const levels: [string, string, number][] = [
+    ['building', 'Building', Number(values.buildings)],
+    ['sector', 'Sector', Number(values.sectors)],
+    ['floor', 'Floor', Number(values.floors)],
+    ['room', 'Room', Number(values.rooms)],
+  ];
+
+  let parents: (number | null)[] = [null];
+  for (const [type, label, perParent] of levels) {
+    const rows = parents.flatMap((parentId) =>
+      Array.from({ length: perParent }, (_, i) => ({
+        name: `${label} ${i + 1}`,
+        type,
+        description: LOCATION_MARKER,
+        parentId,
+        ownerId,
+      })),
+    );
+    const inserted = await db
+      .insert(locations)
+      .values(rows)
+      .returning({ id: locations.id });
+    parents = inserted.map((row) => row.id);
+
+    // Closure rows for the new level, derived from their parents' rows
+    const ids = sql.join(
+      inserted.map((row) => sql`${row.id}`),
+      sql`, `,
+    );
+    await db.execute(sql`
+      INSERT INTO ${locationClosure} (ancestor_id, descendant_id, depth)
+      SELECT closure.ancestor_id, l.id, closure.depth + 1
+      FROM ${locations} l
+      JOIN ${locationClosure} closure ON closure.descendant_id = l.parent_id
+      WHERE l.id IN (${ids})
+      UNION ALL
+      SELECT l.id, l.id, 0
+      FROM ${locations} l
+      WHERE l.id IN (${ids})
+    `);
+  }
+  return parents as number[];
+}
+
+async function createDevices(
+  ownerId: string,
+  count: number,
+  rooms: number[],
+  lastSeenAt: Date,
+): Promise<string[]> {
+  const rows = Array.from({ length: count }, (_, i) => ({
+    id: `${DEVICE_PREFIX}${String(i + 1).padStart(6, '0')}`,
+    name: `Synthetic sensor ${i + 1}`,
+    locationId: rooms[i % rooms.length],
+    ownerId,
+    lastSeenAt,
+  }));
+
+  for (let i = 0; i < rows.length; i += 1000) {
+    await db.insert(devices).values(rows.slice(i, i + 1000));
+  }
+  return rows.map((row) => row.id);
+}
+
+// A mix of always-on, office-hours and humidity rules
+async function createAlerts(deviceIds: string[]) {
+  const rows = deviceIds.map((deviceId, i) => {
+    const emails = [values['alert-email']];
+    switch (i % 3) {
+      case 0:
+        return { deviceId, type: 'temperature', maxThreshold: 28, emails };
+      case 1:
+        return {
+          deviceId,
+          type: 'temperature',
+          minThreshold: 16,
+          maxThreshold: 26,
+          startTime: '08:00',
+          endTime: '18:00',
+          daysOfWeek: [1, 2, 3, 4, 5],
+          emails,
+        };
+      default:
+        return { deviceId, type: 'humidity', maxThreshold: 70, emails };
+    }
+  });
+
+  for (let i = 0; i < rows.length; i += 1000) {
+    await db.insert(alerts).values(rows.slice(i, i + 1000));
+  }
+}
+
+/**
+ * Daily and seasonal cycles with a per-device offset plus noise, and about
+ * 0.5% of samples missing so gaps show up like they do with real devices.
+ */
+async function insertReadings(
+  deviceIds: string[],
+  from: Date,
+  to: Date,
+  intervalSeconds: number,
+) {
+  await db.execute(sql`
+    INSERT INTO ${temperatureReadings}
+      (taken_at, temperature_c, humidity, device_id, device_timestamp)
+    SELECT
+      ts,
+      (20 + (d.n % 7) - 3
+        + 3 * sin(2 * pi() * extract(epoch from ts) / 86400 + d.n)
+        + 4 * sin(2 * pi() * extract(epoch from ts) / 31557600)
+        + (random() - 0.5))::real,
+      (50 + 10 * sin(2 * pi() * extract(epoch from ts) / 86400 + d.n / 2.0)
+        + 5 * (random() - 0.5))::real,
+      d.id,
+      ts - interval '200 milliseconds'
+    FROM unnest(${textArray(deviceIds)}) WITH ORDINALITY AS d(id, n)
+    CROSS JOIN generate_series(
+      ${from.toISOString()}::timestamptz,
+      ${to.toISOString()}::timestamptz - interval '1 millisecond',
+      ${`${intervalSeconds} seconds`}::interval
+    ) AS ts
+    WHERE random() > 0.005
+  `);
+}
+
+async function insertAggregates(
+  granularity: string,
+  bucket: string,
+  from: Date,
+  to: Date,
+) {
+  await db.execute(sql`
+    INSERT INTO ${temperatureAggregates}
+      (bucket_start, granularity, median_c, device_id)
+    SELECT
+      ${sql.raw(bucket)} AS bucket,
+      ${granularity},
+      percentile_cont(0.5) WITHIN GROUP (ORDER BY temperature_c::float4),
+      device_id
+    FROM ${temperatureReadings}
+    WHERE device_id LIKE ${`${DEVICE_PREFIX}%`}
+      AND taken_at >= ${from.toISOString()}::timestamptz
+      AND taken_at < ${to.toISOString()}::timestamptz
+    GROUP BY device_id, bucket
+  `);
+}
+
+async function reset() {
+  console.log('Removing previously generated data');
+  const prefix = `${DEVICE_PREFIX}%`;
+  await db
+    .delete(temperatureReadings)
+    .where(like(temperatureReadings.deviceId, prefix));
+  await db
+    .delete(temperatureAggregates)
+    .where(like(temperatureAggregates.deviceId, prefix));
+  // Alerts cascade with their devices
+  await db.delete(devices).where(like(devices.id, prefix));
+  await db.delete(locations).where(eq(locations.description, LOCATION_MARKER));
+}
+
+function textArray(items: string[]): SQL {
+  return sql`ARRAY[${sql.join(
+    items.map((item) => sql`${item}`),
+    sql`, `,
+  )}]::text[]`;
+}
+
+main()
+  .catch((error) => {
+    console.error(error);
+    process.exitCode = 1;
+  })
+  .finally(() => pool.end());
@@ -0,0 +1,25 @@
+// Generated from schema/telemetry.schema.json by
+// backend/tools/gen-telemetry-schema.ts. Do not edit; run
+// `npm run codegen:telemetry` in backend/ instead.
+#pragma once
+
+#define TELEMETRY_TOPIC "heatsync/telemetry"
+
+// Device MAC address or other stable id
+#define TELEMETRY_DEVICE_ID_KEY "deviceId"
+#define TELEMETRY_DEVICE_ID_MIN_LENGTH 1
+#define TELEMETRY_DEVICE_ID_MAX_LENGTH 64
+
+// Degrees Celsius
+#define TELEMETRY_TEMPERATURE_KEY "temperature"
+#define TELEMETRY_TEMPERATURE_MIN (-55.0f)
+#define TELEMETRY_TEMPERATURE_MAX 125.0f
+
+// Relative humidity in percent
+#define TELEMETRY_HUMIDITY_KEY "humidity"
+#define TELEMETRY_HUMIDITY_MIN 0.0f
+#define TELEMETRY_HUMIDITY_MAX 100.0f
+
+// Device clock at sampling time, epoch milliseconds
+#define TELEMETRY_TIMESTAMP_KEY "timestamp"
+#define TELEMETRY_TIMESTAMP_MIN 0
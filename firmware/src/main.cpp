@@ -6,6 +6,7 @@
 #include <FS.h>
 #include <time.h>
 #include <sys/time.h>
+#include "telemetry_schema.h"
 
 #define LED_BUILTIN 2
 #define DHTPIN 4
@@ -129,7 +130,14 @@ void loop()
         float temperature = dht.readTemperature();
         float humidity = dht.readHumidity();
 
-        if (!isnan(temperature) && !isnan(humidity))
+        // The backend rejects readings outside the schema limits, so a
+        // glitching sensor is caught here instead
+        bool inRange = temperature >= TELEMETRY_TEMPERATURE_MIN &&
+                       temperature <= TELEMETRY_TEMPERATURE_MAX &&
+                       humidity >= TELEMETRY_HUMIDITY_MIN &&
+                       humidity <= TELEMETRY_HUMIDITY_MAX;
+
+        if (!isnan(temperature) && !isnan(humidity) && inRange)
         {
             JsonDocument doc;
 
@@ -137,22 +145,22 @@ void loop()
             gettimeofday(&tv, NULL);
             unsigned long long timestamp_ms = (unsigned long long)(tv.tv_sec) * 1000 + (unsigned long long)(tv.tv_usec) / 1000;
 
-            doc["deviceId"] = WiFi.macAddress();
-            doc["temperature"] = temperature;
-            doc["humidity"] = humidity;
-            doc["timestamp"] = timestamp_ms;
+            doc[TELEMETRY_DEVICE_ID_KEY] = WiFi.macAddress();
+            doc[TELEMETRY_TEMPERATURE_KEY] = temperature;
+            doc[TELEMETRY_HUMIDITY_KEY] = humidity;
+            doc[TELEMETRY_TIMESTAMP_KEY] = timestamp_ms;
 
             // Serialize JSON to a string
             char payload[256];
             serializeJson(doc, payload);
 
-            client.publish("heatsync/telemetry", payload);
+            client.publish(TELEMETRY_TOPIC, payload);
             Serial.print("Published message: ");
             Serial.println(payload);
         }
         else
         {
-            Serial.println("Failed to read from DHT sensor!");
+            Serial.println("Failed to read a valid value from DHT sensor!");
         }
     }
 }
@@ -31,25 +31,16 @@ type TimeRange = "live" | "15m" | "1h" | "6h" | "24h" | "7d";
 
 interface TimeRangeConfig {
   label: string;
-  granularity: "1m" | "5m" | "1h" | "6h" | "1d" | null;
   duration: number | null;
 }
 
 const TIME_RANGES: Record<TimeRange, TimeRangeConfig> = {
-  live: { label: "Live", granularity: null, duration: null },
-  "15m": { label: "15 Min", granularity: "1m", duration: 15 * 60 * 1000 },
-  "1h": { label: "1 Hour", granularity: "5m", duration: 60 * 60 * 1000 },
-  "6h": { label: "6 Hours", granularity: "1h", duration: 6 * 60 * 60 * 1000 },
-  "24h": {
-    label: "24 Hours",
-    granularity: "6h",
-    duration: 24 * 60 * 60 * 1000,
-  },
-  "7d": {
-    label: "7 Days",
-    granularity: "1d",
-    duration: 7 * 24 * 60 * 60 * 1000,
-  },
+  live: { label: "Live", duration: null },
+  "15m": { label: "15 Min", duration: 15 * 60 * 1000 },
+  "1h": { label: "1 Hour", duration: 60 * 60 * 1000 },
+  "6h": { label: "6 Hours", duration: 6 * 60 * 60 * 1000 },
+  "24h": { label: "24 Hours", duration: 24 * 60 * 60 * 1000 },
+  "7d": { label: "7 Days", duration: 7 * 24 * 60 * 60 * 1000 },
 };
 
 interface TemperatureChartProps {
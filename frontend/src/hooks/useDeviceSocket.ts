@@ -1,13 +1,18 @@
 "use client";
 
-import { useEffect, useState, useCallback } from "react";
+import { useEffect, useState, useCallback, useRef } from "react";
 import { useSocket } from "./useSocket";
+import { TelemetryDecoder } from "@/lib/telemetry-codec";
+import { reportTelemetryTrace } from "@/lib/telemetry-trace";
 import {
   Device,
   TemperatureUpdate,
   HumidityUpdate,
   DeviceStats,
   TemperatureAggregate,
+  TelemetryTrace,
+  LocationStats,
+  LocationSubscription,
 } from "@/types/device";
 
 interface UseDeviceSocketReturn {
@@ -17,6 +22,10 @@ interface UseDeviceSocketReturn {
   stats: DeviceStats[];
   subscribeToDevices: (deviceIds: string[]) => void;
   unsubscribeFromDevices: (deviceIds: string[]) => void;
+  // Subscribed locations with their member devices and latest stats
+  locations: Record<number, LocationSubscription>;
+  subscribeToLocations: (locationIds: number[]) => void;
+  unsubscribeFromLocations: (locationIds: number[]) => void;
   onTemperatureUpdate: (
     callback: (update: TemperatureUpdate) => void
   ) => () => void;
@@ -30,9 +39,9 @@ interface UseDeviceSocketReturn {
   requestStats: (from?: Date, to?: Date) => void;
   requestAggregates: (
     deviceId: string,
-    granularity: "1m" | "5m" | "1h" | "6h" | "1d",
     from: Date,
-    to: Date
+    to: Date,
+    points?: number
   ) => void;
   onAggregatesData: (
     callback: (data: {
@@ -47,8 +56,15 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
   const { socket, isConnected, error: socketError } = useSocket();
   const [devices, setDevices] = useState<Device[]>([]);
   const [stats, setStats] = useState<DeviceStats[]>([]);
+  const [locations, setLocations] = useState<
+    Record<number, LocationSubscription>
+  >({});
   const [isLoading, setIsLoading] = useState(true);
   const [error, setError] = useState<string | null>(null);
+  const decoderRef = useRef(new TelemetryDecoder());
+  const updateListenersRef = useRef(
+    new Set<(updates: TemperatureUpdate[]) => void>()
+  );
 
   // Request devices list
   const requestDevices = useCallback(() => {
@@ -72,16 +88,11 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
 
   // Request aggregates
   const requestAggregates = useCallback(
-    (
-      deviceId: string,
-      granularity: "1m" | "5m" | "1h" | "6h" | "1d",
-      from: Date,
-      to: Date
-    ) => {
+    (deviceId: string, from: Date, to: Date, points?: number) => {
       if (socket && isConnected) {
         socket.emit("aggregates:request", {
           deviceId,
-          granularity,
+          points,
           from: from.toISOString(),
           to: to.toISOString(),
         });
@@ -128,19 +139,38 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
       }
     );
 
-    socket.on("temperature:update", (update: TemperatureUpdate) => {
+    // Updates arrive coalesced, at most one per device per frame
+    const applyUpdates = (updates: TemperatureUpdate[]) => {
+      const byDevice = new Map(updates.map((u) => [u.deviceId, u]));
       setDevices((prev) =>
-        prev.map((d) =>
-          d.id === update.deviceId
+        prev.map((d) => {
+          const update = byDevice.get(d.id);
+          return update
             ? {
                 ...d,
                 currentTemperature: update.temperatureC,
                 currentHumidity: update.humidity ?? d.currentHumidity,
                 lastReading: new Date(update.timestamp),
               }
-            : d
-        )
+            : d;
+        })
       );
+      updateListenersRef.current.forEach((listener) => listener(updates));
+    };
+
+    const decoder = decoderRef.current;
+    socket.on(
+      "telemetry:index",
+      ({ epoch, deviceIds }: { epoch: number; deviceIds: string[] }) => {
+        decoder.setIndex(epoch, deviceIds);
+      }
+    );
+    socket.on("telemetry:frame", (frame: ArrayBuffer) => {
+      applyUpdates(decoder.decode(frame));
+    });
+    socket.on("telemetry:batch", applyUpdates);
+    socket.on("telemetry:trace", (trace: TelemetryTrace) => {
+      reportTelemetryTrace(socket, trace);
     });
 
     socket.on("data:humidity", (update: HumidityUpdate) => {
@@ -157,6 +187,50 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
       );
     });
 
+    socket.on(
+      "locations:initial",
+      (data: ({ locationId: number } & LocationSubscription)[]) => {
+        setLocations(
+          Object.fromEntries(
+            data.map(({ locationId, deviceIds, stats }) => [
+              locationId,
+              { deviceIds, stats },
+            ])
+          )
+        );
+      }
+    );
+
+    socket.on("location:stats", (stats: LocationStats) => {
+      const { locationId } = stats;
+      setLocations((prev) =>
+        prev[locationId]
+          ? { ...prev, [locationId]: { ...prev[locationId], stats } }
+          : prev
+      );
+    });
+
+    // Devices moved in or out of a subscribed location
+    socket.on(
+      "location:members",
+      (data: { locationId: number; deviceIds: string[] }) => {
+        const { locationId, deviceIds } = data;
+        setLocations((prev) =>
+          prev[locationId]
+            ? { ...prev, [locationId]: { ...prev[locationId], deviceIds } }
+            : prev
+        );
+      }
+    );
+
+    socket.on("location:removed", ({ locationId }: { locationId: number }) => {
+      setLocations((prev) => {
+        const next = { ...prev };
+        delete next[locationId];
+        return next;
+      });
+    });
+
     socket.on("error", (err: { message: string }) => {
       setError(err.message);
       setIsLoading(false);
@@ -169,8 +243,15 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
       socket.off("device:updated");
       socket.off("device:removed");
       socket.off("device:status");
-      socket.off("temperature:update");
+      socket.off("telemetry:index");
+      socket.off("telemetry:frame");
+      socket.off("telemetry:batch");
+      socket.off("telemetry:trace");
       socket.off("data:humidity");
+      socket.off("locations:initial");
+      socket.off("location:stats");
+      socket.off("location:members");
+      socket.off("location:removed");
       socket.off("error");
     };
   }, [socket, isConnected, requestDevices, requestStats]);
@@ -193,14 +274,40 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
     [socket, isConnected]
   );
 
+  const subscribeToLocations = useCallback(
+    (locationIds: number[]) => {
+      if (socket && isConnected) {
+        socket.emit("locations:subscribe", { locationIds });
+      }
+    },
+    [socket, isConnected]
+  );
+
+  const unsubscribeFromLocations = useCallback(
+    (locationIds: number[]) => {
+      if (socket && isConnected) {
+        socket.emit("locations:unsubscribe", { locationIds });
+        setLocations((prev) => {
+          const next = { ...prev };
+          locationIds.forEach((id) => delete next[id]);
+          return next;
+        });
+      }
+    },
+    [socket, isConnected]
+  );
+
   const onTemperatureUpdate = useCallback(
     (callback: (update: TemperatureUpdate) => void) => {
       if (!socket) return () => {};
 
-      socket.on("temperature:update", callback);
+      const listener = (updates: TemperatureUpdate[]) =>
+        updates.forEach(callback);
+      const listeners = updateListenersRef.current;
+      listeners.add(listener);
 
       return () => {
-        socket.off("temperature:update", callback);
+        listeners.delete(listener);
       };
     },
     [socket]
@@ -299,6 +406,9 @@ export function useDeviceSocket(): UseDeviceSocketReturn {
     stats,
     subscribeToDevices,
     unsubscribeFromDevices,
+    locations,
+    subscribeToLocations,
+    unsubscribeFromLocations,
     onTemperatureUpdate,
     onHumidityUpdate,
     onDeviceAdded,
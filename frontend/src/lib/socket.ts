@@ -8,6 +8,8 @@ export function createSocketConnection(options: SocketOptions): Socket {
   const socket = io(process.env.NEXT_PUBLIC_SOCKET_URL, {
     auth: {
       token: options.token,
+      // Compact binary telemetry frames instead of JSON batches
+      protocol: "binary",
     },
     autoConnect: false,
   });
@@ -0,0 +1,47 @@
+import { TemperatureUpdate } from "@/types/device";
+
+// Decoder for the binary `telemetry:frame` layout, see
+// backend/src/websocket/telemetry-codec.ts for the byte layout.
+const TELEMETRY_FRAME_VERSION = 1;
+const HEADER_BYTES = 13;
+const ENTRY_BYTES = 14;
+
+export class TelemetryDecoder {
+  private epoch = -1;
+  private deviceIds: string[] = [];
+
+  setIndex(epoch: number, deviceIds: string[]) {
+    this.epoch = epoch;
+    this.deviceIds = deviceIds;
+  }
+
+  decode(frame: ArrayBuffer | ArrayBufferView): TemperatureUpdate[] {
+    const view = ArrayBuffer.isView(frame)
+      ? new DataView(frame.buffer, frame.byteOffset, frame.byteLength)
+      : new DataView(frame);
+
+    if (view.getUint8(0) !== TELEMETRY_FRAME_VERSION) return [];
+    // Frame was encoded against a device index we have since replaced
+    if (view.getUint16(1, true) !== this.epoch) return [];
+
+    const base = view.getFloat64(3, true);
+    const count = view.getUint16(11, true);
+    const updates: TemperatureUpdate[] = [];
+
+    for (let i = 0; i < count; i++) {
+      const offset = HEADER_BYTES + i * ENTRY_BYTES;
+      const deviceId = this.deviceIds[view.getUint16(offset, true)];
+      if (deviceId === undefined) continue;
+
+      const humidity = view.getFloat32(offset + 6, true);
+      updates.push({
+        deviceId,
+        temperatureC: view.getFloat32(offset + 2, true),
+        humidity: Number.isNaN(humidity) ? null : humidity,
+        timestamp: base + view.getInt32(offset + 10, true),
+      });
+    }
+
+    return updates;
+  }
+}
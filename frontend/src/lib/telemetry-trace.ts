@@ -0,0 +1,21 @@
+import type { Socket } from "socket.io-client";
+import type { TelemetryTrace } from "@/types/device";
+
+/**
+ * Reports when a traced reading reached this browser and when it was on
+ * screen. The trace arrives right after the frame that carried the
+ * reading, so the second animation frame from now is after that frame's
+ * updates were rendered and painted.
+ */
+export function reportTelemetryTrace(socket: Socket, trace: TelemetryTrace) {
+  const clientReceivedAt = Date.now();
+  requestAnimationFrame(() =>
+    requestAnimationFrame(() => {
+      socket.emit("telemetry:trace", {
+        traceId: trace.traceId,
+        clientReceivedAt,
+        renderedAt: Date.now(),
+      });
+    })
+  );
+}
@@ -35,6 +35,23 @@ export interface LocationTreeNode extends Location {
   children: LocationTreeNode[];
 }
 
+// Live statistics over every device in a location's subtree
+export interface LocationStats {
+  locationId: number;
+  deviceCount: number;
+  reportingCount: number;
+  avgTemperature: number | null;
+  minTemperature: number | null;
+  maxTemperature: number | null;
+  avgHumidity: number | null;
+  lastReading: Date | null;
+}
+
+export interface LocationSubscription {
+  deviceIds: string[];
+  stats: LocationStats | null;
+}
+
 export interface TemperatureReading {
   id: number;
   takenAt: Date;
@@ -47,7 +64,19 @@ export interface TemperatureUpdate {
   deviceId: string;
   temperatureC: number;
   humidity?: number | null;
-  timestamp: string;
+  // ISO string or epoch milliseconds
+  timestamp: string | number;
+}
+
+// Sampled reading followed from the device to this browser; epoch ms
+export interface TelemetryTrace {
+  // Echoed back in the report
+  traceId: number;
+  deviceId: string;
+  deviceAt: number;
+  receivedAt: number;
+  committedAt?: number;
+  emittedAt: number;
 }
 
 export interface HumidityUpdate {